@@ -5,7 +5,7 @@ using namespace cp;
 class TestApp : public Application {
 private:
     void start() override {
-		mRenderer = std::make_unique<Renderer>(device(), swapchain(), eventHandler());
+		mRenderer = std::make_unique<Renderer>(device(), renderTarget(), eventHandler());
 
 		Shader shader(gConstants.spirvDir / "vert.spv", gConstants.spirvDir / "frag.spv");
 
@@ -74,7 +74,13 @@ private:
 	Transform mMeshTf2;
 };
 
-int main() {
+int main(int argc, char** argv) {
+	ApplicationSpecification spec{};
+	if (argc > 1 && std::string_view(argv[1]) == "--headless") {
+		spec.headless = true;
+		spec.frameCount = 600;
+	}
+
 	Application& app = Application::create<TestApp>();
-    app.run();
+    app.run(spec);
 }
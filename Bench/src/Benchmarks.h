@@ -0,0 +1,86 @@
+#pragma once
+#include <Application.h>
+#include "Json.h"
+#include "Stats.h"
+#include <deque>
+
+namespace bench {
+	struct BenchOptions {
+		uint32_t frames = 300;
+		uint32_t warmupFrames = 10;
+		uint32_t objects = 10'000;
+		uint32_t pipelines = 32;
+		uint32_t uploadMeshesPerFrame = 16;
+		uint32_t uploadVertices = 4096;
+		uint32_t distinctMeshes = 256;
+		uint32_t distinctVertices = 64;
+		uint32_t loadMeshes = 10'000;
+		uint32_t loadVertices = 1024;
+		uint32_t recordingThreads = 1;
+		// instanced pipelines need assets/shadersbin/instanced.spv
+		bool instanced = false;
+		// runs a single scene when set
+		std::string scene;
+		uint32_t width = 1280;
+		uint32_t height = 720;
+	};
+
+	void runCullingBenchmark(JsonWriter& json);
+	void runMeshOptimizerBenchmark(JsonWriter& json);
+
+	// headless application running the stress scenes back to back, one renderer per scene
+	class StressBenchApp : public cp::Application {
+	public:
+		StressBenchApp(const BenchOptions& options, JsonWriter& json);
+
+	private:
+		void start() override;
+		void update() override;
+
+		struct FrameSample {
+			double cpuFrameMs = 0.0;
+			double submitMs = 0.0;
+			double recordMs = 0.0;
+			double uploadMs = 0.0;
+			uint64_t uploadBytes = 0;
+			uint32_t drawCalls = 0;
+			uint32_t bufferBinds = 0;
+			uint64_t triangles = 0;
+		};
+
+		using SubmitFunc = std::function<void(uint32_t frame)>;
+		// returns the number of bytes uploaded
+		using UploadFunc = std::function<uint64_t(uint32_t frame)>;
+
+		void runScene(std::string_view name, uint32_t pipelineCount, const SubmitFunc& submit, const UploadFunc& upload = {});
+		void writeScene(
+			std::string_view name,
+			const std::vector<FrameSample>& samples,
+			const std::vector<double>& gpuFrameMs,
+			const cp::MemoryStatistics& memory
+		);
+
+		void runStaticMeshes();
+		void runAnimatedTransforms();
+		void runManyPipelines();
+		void runMeshUploads();
+		void runDistinctMeshes(bool pooled);
+		void runMeshLoad();
+		void runLodMeshes();
+		void runModelImport();
+
+		bool sceneEnabled(std::string_view name) const { return mOptions.scene.empty() || mOptions.scene == name; }
+		cp::Transform gridTransform(uint32_t idx) const;
+
+	private:
+		BenchOptions mOptions;
+		JsonWriter& mJson;
+
+		std::unique_ptr<cp::Renderer> mRenderer;
+		std::vector<cp::PipelineHandle> mPipelines;
+		std::unique_ptr<cp::Mesh<cp::PositionColorVertex>> mCube;
+		std::vector<cp::Transform> mTransforms;
+		// meshes created by the upload scene stay alive until the frames using them are done
+		std::deque<std::vector<std::unique_ptr<cp::Mesh<cp::PositionColorVertex>>>> mUploadedMeshes;
+	};
+}
@@ -0,0 +1,56 @@
+#include "Benchmarks.h"
+#include <Graphics/Culling.h>
+#include <random>
+
+using namespace cp;
+
+namespace bench {
+	template <class F>
+	static double measureMs(uint iterations, F&& func) {
+		auto start = std::chrono::steady_clock::now();
+		for (uint i = 0; i < iterations; i++) {
+			func();
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / iterations;
+	}
+
+	void runCullingBenchmark(JsonWriter& json) {
+		constexpr size_t objectCount = 100'000;
+		constexpr uint iterations = 200;
+
+		// objects scattered around a camera looking down -z, roughly a third end up visible
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> position(-200.f, 200.f);
+		std::uniform_real_distribution<float> radius(0.5f, 4.f);
+
+		std::vector<glm::vec4> spheres(objectCount);
+		for (glm::vec4& sphere : spheres) {
+			sphere = { position(rng), position(rng), position(rng), radius(rng) };
+		}
+
+		glm::mat4 projection = glm::perspective(glm::radians(70.f), 16.f / 9.f, 0.1f, 300.f);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+		Frustum frustum = Frustum::fromMatrix(projection * view);
+
+		std::vector<uint8_t> visibility(objectCount);
+		size_t visibleCount = 0;
+
+		double scalarMs = measureMs(iterations, [&]() {
+			visibleCount = cullSpheresScalar(frustum, spheres, visibility.data());
+		});
+		double simdMs = measureMs(iterations, [&]() {
+			visibleCount = cullSpheres(frustum, spheres, visibility.data());
+		});
+
+		json.beginObject("culling");
+		json.value("objects", (uint64_t)objectCount);
+		json.value("visible", (uint64_t)visibleCount);
+		json.value("instructionSet", cullingInstructionSet());
+		json.value("scalarMs", scalarMs);
+		json.value("scalarObjectsPerMs", objectCount / scalarMs);
+		json.value("simdMs", simdMs);
+		json.value("simdObjectsPerMs", objectCount / simdMs);
+		json.endObject();
+	}
+}
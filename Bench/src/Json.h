@@ -0,0 +1,71 @@
+#pragma once
+#include <include.h>
+
+namespace bench {
+	// minimal streaming JSON writer for benchmark reports, keys are expected to be plain identifiers
+	class JsonWriter {
+	public:
+		void beginObject(std::string_view key = {}) { open(key, '{'); }
+		void endObject() { close('}'); }
+		void beginArray(std::string_view key = {}) { open(key, '['); }
+		void endArray() { close(']'); }
+
+		void value(std::string_view key, double number) {
+			writeKey(key);
+			char buffer[32];
+			snprintf(buffer, sizeof(buffer), "%.4f", number);
+			mStream << buffer;
+		}
+
+		void value(std::string_view key, uint64_t number) {
+			writeKey(key);
+			mStream << number;
+		}
+
+		void value(std::string_view key, bool flag) {
+			writeKey(key);
+			mStream << (flag ? "true" : "false");
+		}
+
+		void value(std::string_view key, std::string_view text) {
+			writeKey(key);
+			mStream << '"';
+			for (char c : text) {
+				if (c == '"' || c == '\\') mStream << '\\';
+				mStream << c;
+			}
+			mStream << '"';
+		}
+
+		void value(std::string_view key, const char* text) { value(key, std::string_view(text)); }
+
+		std::string str() const { return mStream.str(); }
+
+	private:
+		void open(std::string_view key, char bracket) {
+			writeKey(key);
+			mStream << bracket;
+			mFirst.push_back(true);
+		}
+
+		void close(char bracket) {
+			mFirst.pop_back();
+			mStream << '\n' << std::string(mFirst.size(), '\t') << bracket;
+		}
+
+		void writeKey(std::string_view key) {
+			if (!mFirst.empty()) {
+				if (!mFirst.back()) mStream << ',';
+				mFirst.back() = false;
+				mStream << '\n' << std::string(mFirst.size(), '\t');
+			}
+			if (!key.empty()) {
+				mStream << '"' << key << "\": ";
+			}
+		}
+
+	private:
+		std::ostringstream mStream;
+		std::vector<bool> mFirst;
+	};
+}
@@ -0,0 +1,59 @@
+#include "Benchmarks.h"
+#include <Graphics/MeshOptimizer.h>
+#include <Graphics/MeshSimplifier.h>
+#include <random>
+
+using namespace cp;
+
+namespace bench {
+	void runMeshOptimizerBenchmark(JsonWriter& json) {
+		constexpr uint side = 256;
+
+		// a grid with its triangles shuffled, the order an exporter without cache optimization may produce
+		std::vector<PositionColorVertex> vertices;
+		vertices.reserve(side * side);
+		for (uint y = 0; y < side; y++) {
+			for (uint x = 0; x < side; x++) {
+				float height = std::sin(x * 0.1f) * std::cos(y * 0.1f);
+				vertices.push_back({ { (float)x, height, (float)y }, { 1.f, 1.f, 1.f, 1.f } });
+			}
+		}
+
+		std::vector<std::array<uint, 3>> triangles;
+		for (uint y = 0; y + 1 < side; y++) {
+			for (uint x = 0; x + 1 < side; x++) {
+				uint i0 = y * side + x;
+				uint i2 = i0 + side;
+				triangles.push_back({ i0, i2, i0 + 1 });
+				triangles.push_back({ i0 + 1, i2, i2 + 1 });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+
+		std::vector<uint> indices;
+		indices.reserve(triangles.size() * 3);
+		for (const auto& triangle : triangles) {
+			indices.insert(indices.end(), triangle.begin(), triangle.end());
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		MeshOptimizationReport report = optimizeMesh(vertices, indices);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		std::vector<glm::vec3> positions = vertexPositions(std::span<const PositionColorVertex>(vertices));
+		start = std::chrono::steady_clock::now();
+		LodChain lodChain = generateLodChain(indices, positions);
+		std::chrono::duration<double, std::milli> lodElapsed = std::chrono::steady_clock::now() - start;
+
+		json.beginObject("meshOptimizer");
+		json.value("triangles", (uint64_t)triangles.size());
+		json.value("acmrBefore", (double)report.acmrBefore);
+		json.value("acmrAfter", (double)report.acmrAfter);
+		json.value("optimizeMs", elapsed.count());
+		json.value("lodLevels", (uint64_t)lodChain.lods.size());
+		json.value("lodCoarsestTriangles", (uint64_t)(lodChain.lods.back().indexCount / 3));
+		json.value("lodCoarsestError", (double)lodChain.lods.back().error);
+		json.value("lodGenerateMs", lodElapsed.count());
+		json.endObject();
+	}
+}
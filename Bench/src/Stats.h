@@ -0,0 +1,48 @@
+#pragma once
+#include "Json.h"
+
+namespace bench {
+	struct SampleStats {
+		double mean = 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+
+		static SampleStats from(std::vector<double> samples) {
+			SampleStats stats{};
+			if (samples.empty()) return stats;
+
+			std::sort(samples.begin(), samples.end());
+
+			// nearest rank percentiles
+			auto percentile = [&](double p) {
+				size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+				return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+			};
+
+			double sum = 0.0;
+			for (double sample : samples) sum += sample;
+
+			stats.mean = sum / samples.size();
+			stats.min = samples.front();
+			stats.max = samples.back();
+			stats.p50 = percentile(50.0);
+			stats.p90 = percentile(90.0);
+			stats.p99 = percentile(99.0);
+			return stats;
+		}
+
+		void write(JsonWriter& json, std::string_view key) const {
+			json.beginObject(key);
+			json.value("mean", mean);
+			json.value("min", min);
+			json.value("max", max);
+			json.value("p50", p50);
+			json.value("p90", p90);
+			json.value("p99", p99);
+			json.endObject();
+		}
+	};
+}
@@ -0,0 +1,470 @@
+#include "Benchmarks.h"
+#include <Graphics/ModelImporter.h>
+#include <cstring>
+
+using namespace cp;
+
+namespace bench {
+	using Clock = std::chrono::steady_clock;
+
+	static double elapsedMs(Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	static std::unique_ptr<Mesh<PositionColorVertex>> createCube() {
+		std::vector<PositionColorVertex> vertices;
+		for (uint i = 0; i < 8; i++) {
+			glm::vec3 corner = { (i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f };
+			vertices.push_back({ corner, glm::vec4(corner + 0.5f, 1.f) });
+		}
+
+		std::vector<uint16> indices = {
+			0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+			0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+			0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5,
+		};
+		return std::make_unique<Mesh<PositionColorVertex>>(vertices, indices);
+	}
+
+	static uint gridSide(uint vertexCount) {
+		return std::max((uint)std::sqrt((float)vertexCount), 2u);
+	}
+
+	static uint64_t gridMeshBytes(uint vertexCount) {
+		uint side = gridSide(vertexCount);
+		return side * side * sizeof(PositionColorVertex) + (side - 1) * (side - 1) * 6 * sizeof(uint16);
+	}
+
+	struct GridData {
+		std::vector<PositionColorVertex> vertices;
+		std::vector<uint16> indices;
+	};
+
+	// deterministic grid mesh so upload sizes are the same between runs
+	static GridData generateGrid(uint vertexCount, uint seed) {
+		uint side = gridSide(vertexCount);
+
+		GridData grid;
+		grid.vertices.reserve(side * side);
+		for (uint y = 0; y < side; y++) {
+			for (uint x = 0; x < side; x++) {
+				float height = (float)((x * 7 + y * 13 + seed) % 17) / 17.f;
+				grid.vertices.push_back({ { x / (float)side - 0.5f, height * 0.1f, y / (float)side - 0.5f }, { height, 0.5f, 1.f - height, 1.f } });
+			}
+		}
+
+		grid.indices.reserve((side - 1) * (side - 1) * 6);
+		for (uint y = 0; y + 1 < side; y++) {
+			for (uint x = 0; x + 1 < side; x++) {
+				uint16 i0 = (uint16)(y * side + x);
+				uint16 i1 = (uint16)(i0 + 1);
+				uint16 i2 = (uint16)(i0 + side);
+				uint16 i3 = (uint16)(i2 + 1);
+				grid.indices.insert(grid.indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+		return grid;
+	}
+
+	static std::unique_ptr<Mesh<PositionColorVertex>> createGridMesh(uint vertexCount, uint seed) {
+		GridData grid = generateGrid(vertexCount, seed);
+		return std::make_unique<Mesh<PositionColorVertex>>(std::move(grid.vertices), std::move(grid.indices), MeshCpuData::Release);
+	}
+
+	StressBenchApp::StressBenchApp(const BenchOptions& options, JsonWriter& json)
+		: mOptions(options), mJson(json) {}
+
+	void StressBenchApp::start() {
+		mCube = createCube();
+
+		mTransforms.resize(mOptions.objects);
+		for (uint i = 0; i < mOptions.objects; i++) {
+			mTransforms[i] = gridTransform(i);
+		}
+	}
+
+	void StressBenchApp::update() {
+		mJson.value("device", device().properties().deviceName);
+		mJson.value("frames", (uint64_t)mOptions.frames);
+		mJson.value("objects", (uint64_t)mOptions.objects);
+		mJson.value("recordingThreads", (uint64_t)mOptions.recordingThreads);
+		mJson.value("instanced", mOptions.instanced);
+
+		mJson.beginArray("scenes");
+		if (sceneEnabled("static_meshes")) runStaticMeshes();
+		if (sceneEnabled("animated_transforms")) runAnimatedTransforms();
+		if (sceneEnabled("many_pipelines")) runManyPipelines();
+		if (sceneEnabled("mesh_uploads")) runMeshUploads();
+		if (sceneEnabled("distinct_meshes")) runDistinctMeshes(false);
+		if (sceneEnabled("pooled_meshes")) runDistinctMeshes(true);
+		mJson.endArray();
+
+		if (sceneEnabled("mesh_load")) runMeshLoad();
+		if (sceneEnabled("lod_meshes")) runLodMeshes();
+		if (sceneEnabled("model_import")) runModelImport();
+
+		mCube.reset();
+		close();
+	}
+
+	Transform StressBenchApp::gridTransform(uint32_t idx) const {
+		uint side = std::max((uint)std::cbrt((float)mOptions.objects), 1u);
+
+		Transform tf{};
+		tf.position = { (float)(idx % side) * 1.5f, (float)(idx / side % side) * 1.5f, -(float)(idx / (side * side)) * 1.5f };
+		tf.position -= glm::vec3(side * 0.75f, side * 0.75f, 0.f);
+		tf.scale = glm::vec3(0.5f);
+		return tf;
+	}
+
+	void StressBenchApp::runScene(std::string_view name, uint32_t pipelineCount, const SubmitFunc& submit, const UploadFunc& upload) {
+		RendererConfiguration rendererConfig{};
+		rendererConfig.recordingThreads = mOptions.recordingThreads;
+		rendererConfig.gpuProfiling = true;
+		mRenderer = std::make_unique<Renderer>(device(), renderTarget(), eventHandler(), rendererConfig);
+
+		std::filesystem::path vertexShader = gConstants.spirvDir / (mOptions.instanced ? "instanced.spv" : "vert.spv");
+		Shader shader(vertexShader, gConstants.spirvDir / "frag.spv");
+
+		PipelineConfiguration pipelineConfig{};
+		pipelineConfig.pShader = &shader;
+		pipelineConfig.instancingEnabled = mOptions.instanced;
+
+		std::vector<PipelineConfiguration> pipelineConfigs(pipelineCount, pipelineConfig);
+		mPipelines = mRenderer->addPipelineConfigurations(pipelineConfigs);
+		mRenderer->usePipeline(mPipelines[0]);
+
+		glm::vec2 viewportSize = mRenderer->viewportSize();
+		glm::mat4 projection = glm::perspective(glm::radians(70.f), viewportSize.x / viewportSize.y, 0.1f, 500.f);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, 30.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+
+		std::vector<FrameSample> samples;
+		samples.reserve(mOptions.frames);
+		std::vector<double> gpuFrameMs;
+		uint64 lastGpuFrame = (uint64)(-1);
+
+		for (uint frame = 0; frame < mOptions.warmupFrames + mOptions.frames; frame++) {
+			FrameSample sample{};
+			auto frameStart = Clock::now();
+
+			if (upload) {
+				sample.uploadBytes = upload(frame);
+			}
+			auto uploadEnd = Clock::now();
+
+			mRenderer->setProjView(projection, view);
+			mRenderer->begin();
+
+			auto submitStart = Clock::now();
+			submit(frame);
+			auto submitEnd = Clock::now();
+
+			mRenderer->end();
+			auto frameEnd = Clock::now();
+
+			if (frame < mOptions.warmupFrames) continue;
+
+			sample.cpuFrameMs = elapsedMs(frameStart, frameEnd);
+			sample.uploadMs = elapsedMs(frameStart, uploadEnd);
+			sample.submitMs = elapsedMs(submitStart, submitEnd);
+			sample.recordMs = mRenderer->statistics().recordTimeMs;
+			sample.drawCalls = mRenderer->statistics().drawCalls;
+			sample.bufferBinds = mRenderer->statistics().bufferBinds;
+			sample.triangles = mRenderer->statistics().triangles;
+			samples.push_back(sample);
+
+			const GpuFrameTimings& gpuTimings = mRenderer->gpuTimings();
+			if (gpuTimings.valid && gpuTimings.frame != lastGpuFrame) {
+				gpuFrameMs.push_back(gpuTimings.frameTimeMs);
+				lastGpuFrame = gpuTimings.frame;
+			}
+		}
+
+		MemoryStatistics memory = device().allocator().statistics();
+
+		device().wait();
+		mUploadedMeshes.clear();
+		mRenderer.reset();
+
+		writeScene(name, samples, gpuFrameMs, memory);
+	}
+
+	void StressBenchApp::writeScene(
+		std::string_view name,
+		const std::vector<FrameSample>& samples,
+		const std::vector<double>& gpuFrameMs,
+		const MemoryStatistics& memory
+	) {
+		std::vector<double> cpuFrameMs, submitMs, recordMs;
+		double uploadMs = 0.0;
+		uint64_t uploadBytes = 0;
+		uint64_t drawCalls = 0;
+		uint64_t bufferBinds = 0;
+		uint64_t triangles = 0;
+
+		for (const FrameSample& sample : samples) {
+			cpuFrameMs.push_back(sample.cpuFrameMs);
+			submitMs.push_back(sample.submitMs);
+			recordMs.push_back(sample.recordMs);
+			uploadMs += sample.uploadMs;
+			uploadBytes += sample.uploadBytes;
+			drawCalls += sample.drawCalls;
+			bufferBinds += sample.bufferBinds;
+			triangles += sample.triangles;
+		}
+
+		mJson.beginObject();
+		mJson.value("name", name);
+		SampleStats::from(cpuFrameMs).write(mJson, "cpuFrameMs");
+		SampleStats::from(submitMs).write(mJson, "submitMs");
+		SampleStats::from(recordMs).write(mJson, "recordMs");
+		SampleStats::from(gpuFrameMs).write(mJson, "gpuFrameMs");
+		mJson.value("drawCallsPerFrame", samples.empty() ? 0.0 : (double)drawCalls / samples.size());
+		mJson.value("bufferBindsPerFrame", samples.empty() ? 0.0 : (double)bufferBinds / samples.size());
+		mJson.value("trianglesPerFrame", samples.empty() ? 0.0 : (double)triangles / samples.size());
+		mJson.value("uploadBytes", uploadBytes);
+		mJson.value("uploadMBps", uploadMs > 0.0 ? uploadBytes / (1024.0 * 1024.0) / (uploadMs / 1000.0) : 0.0);
+
+		mJson.beginObject("memory");
+		mJson.value("blocks", (uint64_t)memory.blockCount);
+		mJson.value("allocations", (uint64_t)memory.allocationCount);
+		mJson.value("bytesReserved", (uint64_t)memory.bytesReserved);
+		mJson.value("bytesUsed", (uint64_t)memory.bytesUsed);
+		mJson.value("fragmentation", (double)memory.fragmentation);
+		mJson.endObject();
+		mJson.endObject();
+	}
+
+	void StressBenchApp::runStaticMeshes() {
+		runScene("static_meshes", 1, [&](uint32_t) {
+			for (const Transform& tf : mTransforms) {
+				mRenderer->submitMesh(*mCube, tf);
+			}
+		});
+	}
+
+	void StressBenchApp::runAnimatedTransforms() {
+		runScene("animated_transforms", 1, [&](uint32_t frame) {
+			for (uint i = 0; i < mTransforms.size(); i++) {
+				Transform tf = mTransforms[i];
+				tf.rotation = glm::vec3(frame * 0.01f + i * 0.1f, frame * 0.02f, 0.f);
+				tf.position.y += std::sin(frame * 0.05f + i) * 0.25f;
+				mRenderer->submitMesh(*mCube, tf);
+			}
+		});
+	}
+
+	void StressBenchApp::runManyPipelines() {
+		runScene("many_pipelines", mOptions.pipelines, [&](uint32_t) {
+			// interleaved on purpose, the draw list has to group them back together
+			for (uint i = 0; i < mTransforms.size(); i++) {
+				mRenderer->usePipeline(mPipelines[i % mPipelines.size()]);
+				mRenderer->submitMesh(*mCube, mTransforms[i]);
+			}
+		});
+	}
+
+	void StressBenchApp::runMeshUploads() {
+		uint64_t bytesPerMesh = gridMeshBytes(mOptions.uploadVertices);
+
+		runScene("mesh_uploads", 1,
+			[&](uint32_t) {
+				const auto& meshes = mUploadedMeshes.back();
+				for (uint i = 0; i < meshes.size(); i++) {
+					mRenderer->submitMesh(*meshes[i], mTransforms[i % mTransforms.size()]);
+				}
+			},
+			[&](uint32_t frame) {
+				// a frame slot is reused after framesInFlight frames, older meshes are not referenced anymore
+				while (mUploadedMeshes.size() > RendererConfiguration{}.framesInFlight) {
+					mUploadedMeshes.pop_front();
+				}
+
+				auto& meshes = mUploadedMeshes.emplace_back();
+				for (uint i = 0; i < mOptions.uploadMeshesPerFrame; i++) {
+					meshes.push_back(createGridMesh(mOptions.uploadVertices, frame * mOptions.uploadMeshesPerFrame + i));
+				}
+				return bytesPerMesh * meshes.size();
+			}
+		);
+	}
+
+	void StressBenchApp::runDistinctMeshes(bool pooled) {
+		std::vector<GridData> grids;
+		for (uint i = 0; i < mOptions.distinctMeshes; i++) {
+			grids.push_back(generateGrid(mOptions.distinctVertices, i));
+		}
+
+		// the same geometry either in a buffer pair per mesh or in one shared pool
+		std::vector<std::unique_ptr<Mesh<PositionColorVertex>>> meshes;
+		std::unique_ptr<GeometryPool<PositionColorVertex>> pool;
+		std::vector<std::unique_ptr<PooledMesh<PositionColorVertex>>> pooledMeshes;
+
+		if (pooled) {
+			size_t vertexCount = grids.size() * grids[0].vertices.size();
+			size_t indexCount = grids.size() * grids[0].indices.size();
+			pool = std::make_unique<GeometryPool<PositionColorVertex>>(device(), vertexCount, indexCount);
+			for (const GridData& grid : grids) {
+				pooledMeshes.push_back(std::make_unique<PooledMesh<PositionColorVertex>>(
+					*pool, std::span<const PositionColorVertex>(grid.vertices), std::span<const uint16>(grid.indices)
+				));
+			}
+		}
+		else {
+			for (const GridData& grid : grids) {
+				meshes.push_back(std::make_unique<Mesh<PositionColorVertex>>(
+					std::span<const PositionColorVertex>(grid.vertices), std::span<const uint16>(grid.indices), MeshCpuData::Release
+				));
+			}
+		}
+
+		runScene(pooled ? "pooled_meshes" : "distinct_meshes", 1, [&](uint32_t) {
+			for (uint i = 0; i < mTransforms.size(); i++) {
+				if (pooled) {
+					mRenderer->submitMesh(*pooledMeshes[i % pooledMeshes.size()], mTransforms[i]);
+				}
+				else {
+					mRenderer->submitMesh(*meshes[i % meshes.size()], mTransforms[i]);
+				}
+			}
+			if (pool) pool->advance();
+		});
+
+		device().wait();
+	}
+
+	void StressBenchApp::runLodMeshes() {
+		// dense enough that distant copies are worth simplifying, trianglesPerFrame shows what the LODs saved
+		GridData grid = generateGrid(128 * 128, 0);
+		std::vector<uint> indices(grid.indices.begin(), grid.indices.end());
+		LodChain lodChain = generateLodChain(indices, vertexPositions(std::span<const PositionColorVertex>(grid.vertices)));
+
+		Mesh<PositionColorVertex> mesh(std::span<const PositionColorVertex>(grid.vertices), lodChain, MeshCpuData::Release);
+
+		runScene("lod_meshes", 1, [&](uint32_t) {
+			for (const Transform& tf : mTransforms) {
+				mRenderer->submitMesh(mesh, tf);
+			}
+		});
+
+		device().wait();
+	}
+
+	void StressBenchApp::runModelImport() {
+		// a 512x512 quad grid written as OBJ, about 28 MB and 520k triangles
+		constexpr uint side = 513;
+		std::filesystem::path path = std::filesystem::temp_directory_path() / "capy_bench_import.obj";
+		{
+			std::ofstream file(path);
+			char line[96];
+			for (uint y = 0; y < side; y++) {
+				for (uint x = 0; x < side; x++) {
+					float height = (float)((x * 7 + y * 13) % 17) / 17.f;
+					snprintf(line, sizeof(line), "v %.5f %.5f %.5f %.3f 0.5 %.3f\n", x / (float)side, height * 0.1f, y / (float)side, height, 1.f - height);
+					file << line;
+				}
+			}
+			for (uint y = 0; y + 1 < side; y++) {
+				for (uint x = 0; x + 1 < side; x++) {
+					uint i0 = y * side + x + 1;
+					snprintf(line, sizeof(line), "f %u %u %u %u\n", i0, i0 + side, i0 + side + 1, i0 + 1);
+					file << line;
+				}
+			}
+		}
+
+		ModelImporter importer;
+
+		Clock::time_point start = Clock::now();
+		std::vector<ImportedMesh<PositionColorVertex>> meshes = importer.import<PositionColorVertex>(path);
+		ResourceManager::uploader().wait();
+		double importMs = elapsedMs(start, Clock::now());
+
+		const ModelImportStatistics& stats = importer.statistics();
+		mJson.beginObject("modelImport");
+		mJson.value("bytes", (uint64_t)std::filesystem::file_size(path));
+		mJson.value("triangles", (uint64_t)stats.triangles);
+		mJson.value("vertices", (uint64_t)stats.vertices);
+		mJson.value("parseMs", (double)stats.parseMs);
+		mJson.value("uploadMs", (double)stats.uploadMs);
+		mJson.value("trianglesPerSecond", importMs > 0.0 ? stats.triangles / (importMs / 1000.0) : 0.0);
+		mJson.endObject();
+
+		meshes.clear();
+		std::filesystem::remove(path);
+	}
+
+	void StressBenchApp::runMeshLoad() {
+		// a few distinct grids reused round robin, generating the data is not part of the measurement
+		std::vector<GridData> grids;
+		for (uint i = 0; i < 8; i++) {
+			grids.push_back(generateGrid(mOptions.loadVertices, i));
+		}
+		uint64_t totalBytes = gridMeshBytes(mOptions.loadVertices) * mOptions.loadMeshes;
+
+		// baseline, the same bytes copied into a host allocation
+		std::vector<uint8_t> sink(gridMeshBytes(mOptions.loadVertices));
+		Clock::time_point memcpyStart = Clock::now();
+		for (uint i = 0; i < mOptions.loadMeshes; i++) {
+			const GridData& grid = grids[i % grids.size()];
+			size_t vertexBytes = grid.vertices.size() * sizeof(PositionColorVertex);
+			std::memcpy(sink.data(), grid.vertices.data(), vertexBytes);
+			std::memcpy(sink.data() + vertexBytes, grid.indices.data(), grid.indices.size() * sizeof(uint16));
+		}
+		double memcpyMs = elapsedMs(memcpyStart, Clock::now());
+
+		UploadStatistics before = ResourceManager::uploader().statistics();
+		std::vector<std::unique_ptr<Mesh<PositionColorVertex>>> meshes;
+		meshes.reserve(mOptions.loadMeshes);
+
+		Clock::time_point loadStart = Clock::now();
+		for (uint i = 0; i < mOptions.loadMeshes; i++) {
+			const GridData& grid = grids[i % grids.size()];
+			meshes.push_back(std::make_unique<Mesh<PositionColorVertex>>(
+				std::span<const PositionColorVertex>(grid.vertices), std::span<const uint16>(grid.indices), MeshCpuData::Release
+			));
+		}
+		ResourceManager::uploader().flush();
+		ResourceManager::uploader().wait();
+		double loadMs = elapsedMs(loadStart, Clock::now());
+		UploadStatistics after = ResourceManager::uploader().statistics();
+
+		// the same grids loaded from mapped mesh files, the files are in the page cache after writing them
+		meshes.clear();
+		std::vector<std::filesystem::path> files;
+		for (uint i = 0; i < grids.size(); i++) {
+			Mesh<PositionColorVertex> mesh(std::span<const PositionColorVertex>(grids[i].vertices), std::span<const uint16>(grids[i].indices));
+			files.push_back(std::filesystem::temp_directory_path() / ("capy_bench_" + std::to_string(i) + ".cpmesh"));
+			writeMeshFile(files.back(), mesh);
+		}
+
+		Clock::time_point fileLoadStart = Clock::now();
+		for (uint i = 0; i < mOptions.loadMeshes; i++) {
+			MeshFile file(files[i % files.size()]);
+			meshes.push_back(std::make_unique<Mesh<PositionColorVertex>>(file));
+		}
+		ResourceManager::uploader().flush();
+		ResourceManager::uploader().wait();
+		double fileLoadMs = elapsedMs(fileLoadStart, Clock::now());
+
+		for (const std::filesystem::path& path : files) {
+			std::filesystem::remove(path);
+		}
+
+		auto mbps = [&](double ms) { return ms > 0.0 ? totalBytes / (1024.0 * 1024.0) / (ms / 1000.0) : 0.0; };
+
+		mJson.beginObject("meshLoad");
+		mJson.value("meshes", (uint64_t)mOptions.loadMeshes);
+		mJson.value("bytes", totalBytes);
+		mJson.value("loadMs", loadMs);
+		mJson.value("loadMBps", mbps(loadMs));
+		mJson.value("memcpyMBps", mbps(memcpyMs));
+		mJson.value("fileLoadMBps", mbps(fileLoadMs));
+		mJson.value("submissions", after.submissions - before.submissions);
+		mJson.value("bytesStaged", after.bytesStaged - before.bytesStaged);
+		mJson.value("bytesDirect", after.bytesDirect - before.bytesDirect);
+		mJson.endObject();
+
+		meshes.clear();
+	}
+}
@@ -0,0 +1,87 @@
+#include "Benchmarks.h"
+#include <fstream>
+
+static void printUsage() {
+	printf(
+		"usage: CapyBench [options]\n"
+		"  --frames <n>      measured frames per scene\n"
+		"  --warmup <n>      frames skipped before measuring\n"
+		"  --objects <n>     meshes submitted per frame\n"
+		"  --pipelines <n>   pipelines used by many_pipelines\n"
+		"  --threads <n>     command buffer recording threads\n"
+		"  --scene <name>    static_meshes, animated_transforms, many_pipelines, mesh_uploads,\n"
+		"                    distinct_meshes, pooled_meshes, mesh_load, lod_meshes or model_import\n"
+		"  --load-meshes <n> meshes created by mesh_load\n"
+		"  --instanced       use instanced pipelines\n"
+		"  --no-culling      skip the CPU culling benchmark\n"
+		"  --no-optimizer    skip the mesh optimizer benchmark\n"
+		"  --out <file>      write the JSON report to a file instead of stdout\n"
+	);
+}
+
+int main(int argc, char** argv) {
+	bench::BenchOptions options{};
+	bool cullingBenchmark = true;
+	bool optimizerBenchmark = true;
+	std::string outPath;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		auto next = [&]() -> const char* {
+			if (i + 1 >= argc) {
+				printUsage();
+				exit(1);
+			}
+			return argv[++i];
+		};
+
+		if (arg == "--frames") options.frames = std::stoul(next());
+		else if (arg == "--warmup") options.warmupFrames = std::stoul(next());
+		else if (arg == "--objects") options.objects = std::stoul(next());
+		else if (arg == "--pipelines") options.pipelines = std::max(std::stoul(next()), 1ul);
+		else if (arg == "--threads") options.recordingThreads = std::max(std::stoul(next()), 1ul);
+		else if (arg == "--load-meshes") options.loadMeshes = std::stoul(next());
+		else if (arg == "--scene") options.scene = next();
+		else if (arg == "--instanced") options.instanced = true;
+		else if (arg == "--no-culling") cullingBenchmark = false;
+		else if (arg == "--no-optimizer") optimizerBenchmark = false;
+		else if (arg == "--out") outPath = next();
+		else {
+			printUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	bench::JsonWriter json;
+	json.beginObject();
+
+	if (cullingBenchmark) {
+		bench::runCullingBenchmark(json);
+	}
+	if (optimizerBenchmark) {
+		bench::runMeshOptimizerBenchmark(json);
+	}
+
+	try {
+		cp::ApplicationSpecification spec{};
+		spec.name = "CapyBench";
+		spec.width = options.width;
+		spec.height = options.height;
+		spec.headless = true;
+		cp::Application::create<bench::StressBenchApp>(options, json).run(spec);
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	json.endObject();
+
+	if (outPath.empty()) {
+		printf("%s\n", json.str().c_str());
+	}
+	else {
+		std::ofstream out(outPath);
+		out << json.str() << '\n';
+	}
+}
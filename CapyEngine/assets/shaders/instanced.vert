@@ -0,0 +1,17 @@
+#version 450
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor;
+layout(location = 4) in mat4 inModel;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 proj;
+    mat4 view;
+} ubo;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * inModel * vec4(inPosition, 1.0);
+    fragColor = inColor;
+}
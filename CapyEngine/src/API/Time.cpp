@@ -6,7 +6,9 @@ namespace cp {
 	float Time::sDeltaTime = 0;
 
 	void Time::update()  {
-		sCurrentTime = (float)glfwGetTime();
+		// steady clock instead of glfwGetTime so headless applications work without GLFW
+		static const auto sStart = std::chrono::steady_clock::now();
+		sCurrentTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - sStart).count();
 		sDeltaTime = sCurrentTime - sLastTime;
 		sLastTime = sCurrentTime;
 	}
@@ -11,42 +11,77 @@ namespace cp {
 		enableVirtualTerminalProcessing();
 	}
 
-	void Application::run() {
+	void Application::run(const ApplicationSpecification& spec) {
+		mSpec = spec;
 		try {
 			Input::init(mEvtHandler);
 			ApplicationConfiguration appConfig{};
-			appConfig.applicationName = "Ligma app";
+			appConfig.applicationName = mSpec.name;
+			appConfig.headless = mSpec.headless;
 			mContext = std::make_unique<VulkanContext>(appConfig);
 
-			WindowSpecification winSpec{};
-			winSpec.instance = mContext->instance();
-			winSpec.title = "Ligma app";
-			winSpec.width = 1200;
-			winSpec.height = 800;
-			mWindow = std::make_unique<Window>(mEvtHandler, winSpec);
-			mDevice = std::make_unique<Device>(mContext->instance(), mWindow->surface());
-			mSwapchain = std::make_unique<Swapchain>(*mDevice, *mWindow);
-
-			ResourceManager::init(*mDevice);
+			if (mSpec.headless) {
+				runHeadless();
+			}
+			else {
+				runWindowed();
+			}
+		}
+		catch (const std::runtime_error& err) {
+			std::cerr << "Runtime error: " << err.what() << "\n";
+		}
+	}
 
-			start();
-			while (!mWindow->shouldClose()) {
-				if (mWindow->minimized()) {
-					mWindow->wait();
-					continue;
-				}
+	void Application::runWindowed() {
+		WindowSpecification winSpec{};
+		winSpec.instance = mContext->instance();
+		winSpec.title = mSpec.name;
+		winSpec.width = (int)mSpec.width;
+		winSpec.height = (int)mSpec.height;
+		mWindow = std::make_unique<Window>(mEvtHandler, winSpec);
+		mDevice = std::make_unique<Device>(mContext->instance(), mWindow->surface(), mSpec.pipelineCachePath);
+		mSwapchain = std::make_unique<Swapchain>(*mDevice, *mWindow);
 
-				Time::update();
-				mWindow->pollEvents();
+		ResourceManager::init(*mDevice);
 
-				update();
+		start();
+		mRunning = true;
+		while (mRunning && !mWindow->shouldClose()) {
+			if (mWindow->minimized()) {
+				mWindow->wait();
+				continue;
 			}
 
-			ResourceManager::cleanup(*mDevice);
-			mDevice->wait();
+			Time::update();
+			mWindow->pollEvents();
+			ResourceManager::collectUploads();
+
+			update();
 		}
-		catch (const std::runtime_error& err) {
-			std::cerr << "Runtime error: " << err.what() << "\n";
+
+		ResourceManager::cleanup(*mDevice);
+		mDevice->wait();
+	}
+
+	void Application::runHeadless() {
+		mDevice = std::make_unique<Device>(mContext->instance(), VK_NULL_HANDLE, mSpec.pipelineCachePath);
+
+		OffscreenTargetSpecification targetSpec{};
+		targetSpec.width = mSpec.width;
+		targetSpec.height = mSpec.height;
+		mOffscreenTarget = std::make_unique<OffscreenTarget>(*mDevice, targetSpec);
+
+		ResourceManager::init(*mDevice);
+
+		start();
+		mRunning = true;
+		for (uint frame = 0; mRunning && (mSpec.frameCount == 0 || frame < mSpec.frameCount); frame++) {
+			Time::update();
+			ResourceManager::collectUploads();
+			update();
 		}
+
+		ResourceManager::cleanup(*mDevice);
+		mDevice->wait();
 	}
 }
@@ -3,6 +3,7 @@
 #include "Vulkan/Window.h"
 #include "Vulkan/Device.h"
 #include "Vulkan/Swapchain.h"
+#include "Vulkan/OffscreenTarget.h"
 #include "Graphics/Renderer.h"
 #include "Events/EventHandler.h"
 #include "API/PerspectiveCamera.h"
@@ -12,33 +13,59 @@
 #include "API/Input.h"
 
 namespace cp {
+	struct ApplicationSpecification {
+		std::string name = "Ligma app";
+		uint width = 1200;
+		uint height = 800;
+
+		// renders into an OffscreenTarget, no window, surface or swapchain is created
+		bool headless = false;
+		// headless applications stop after this many frames, 0 runs until close() is called
+		uint frameCount = 0;
+		// compiled pipelines are kept here between runs, empty disables the on-disk cache
+		std::filesystem::path pipelineCachePath = "pipeline_cache.bin";
+	};
+
 	class Application {
 	public:
-		template <class AppT>
-		static Application& create() {
-			sInstance = std::make_unique<AppT>();
+		template <class AppT, class... Args>
+		static Application& create(Args&&... args) {
+			sInstance = std::make_unique<AppT>(std::forward<Args>(args)...);
 			return *sInstance;
 		}
 		static Application& get();
 
 		Application();
 		virtual ~Application() = default;
-		void run();
+		void run(const ApplicationSpecification& spec = {});
+		void close() { mRunning = false; }
 
 		virtual void start() = 0;
 		virtual void update() = 0;
 
 		VulkanContext& context() { return *mContext; }
-		Window& window() { return *mWindow; }
-		Swapchain& swapchain() { return *mSwapchain; }
+		Window& window() { CP_ASSERT(mWindow, "headless application has no window"); return *mWindow; }
+		Swapchain& swapchain() { CP_ASSERT(mSwapchain, "headless application has no swapchain"); return *mSwapchain; }
+		OffscreenTarget& offscreenTarget() { CP_ASSERT(mOffscreenTarget, "application is not headless"); return *mOffscreenTarget; }
+		// swapchain or offscreen target, whichever the application renders to
+		RenderTarget& renderTarget() { return mSpec.headless ? (RenderTarget&)*mOffscreenTarget : *mSwapchain; }
+		const ApplicationSpecification& specification() const { return mSpec; }
 		Device& device() { return *mDevice; }
 		EventHandler& eventHandler() { return mEvtHandler; }
 
 	private:
+		void runWindowed();
+		void runHeadless();
+
+	private:
+		ApplicationSpecification mSpec;
+		bool mRunning = false;
+
 		std::unique_ptr<VulkanContext> mContext;
 		std::unique_ptr<Window> mWindow;
 		std::unique_ptr<Device> mDevice;
 		std::unique_ptr<Swapchain> mSwapchain;
+		std::unique_ptr<OffscreenTarget> mOffscreenTarget;
 		EventHandler mEvtHandler;
 
 		static std::unique_ptr<Application> sInstance;
@@ -0,0 +1,43 @@
+#pragma once
+#include <include.h>
+
+namespace cp {
+	struct AABB {
+		glm::vec3 min{0.f};
+		glm::vec3 max{0.f};
+
+		glm::vec3 center() const { return (min + max) * 0.5f; }
+		glm::vec3 extents() const { return (max - min) * 0.5f; }
+	};
+
+	struct BoundingSphere {
+		glm::vec3 center{0.f};
+		float radius = 0.f;
+
+		// conservative, the radius is scaled by the largest axis scale of the matrix
+		BoundingSphere transformed(const glm::mat4& model) const {
+			float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+			return { glm::vec3(model * glm::vec4(center, 1.f)), radius * scale };
+		}
+	};
+
+	struct Frustum {
+		// left, right, bottom, top, near, far; normals point inwards and are normalized
+		std::array<glm::vec4, 6> planes{};
+
+		// extracts planes from a clip matrix with the [0, 1] depth range (GLM_FORCE_DEPTH_ZERO_TO_ONE)
+		static Frustum fromMatrix(const glm::mat4& projView) {
+			glm::vec4 row0 = { projView[0][0], projView[1][0], projView[2][0], projView[3][0] };
+			glm::vec4 row1 = { projView[0][1], projView[1][1], projView[2][1], projView[3][1] };
+			glm::vec4 row2 = { projView[0][2], projView[1][2], projView[2][2], projView[3][2] };
+			glm::vec4 row3 = { projView[0][3], projView[1][3], projView[2][3], projView[3][3] };
+
+			Frustum frustum;
+			frustum.planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2 };
+			for (glm::vec4& plane : frustum.planes) {
+				plane /= glm::length(glm::vec3(plane));
+			}
+			return frustum;
+		}
+	};
+}
@@ -1,97 +1,182 @@
 #include "Buffers.h"
 
 namespace cp {
+	VertexBuffer::VertexBuffer(Device& device, size_t size)
+		: mDevice(device) {
+
+		auto [buffer, memory] = ResourceManager::createBuffer(
+			mDevice, std::max<size_t>(size, 1),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		mVertexBuffer = buffer;
+		mBufferMemory = memory;
+		mMappedMemory = mBufferMemory.mapped;
+	}
+
 	VertexBuffer::~VertexBuffer() {
-		vkDestroyBuffer(mDevice.vkDevice(), mVertexBuffer, nullptr);
-		vkFreeMemory(mDevice.vkDevice(), mBufferMemory, nullptr);
+		// the copy may still be reading into the buffer
+		mUpload.wait();
+		ResourceManager::destroyBuffer(mDevice, mVertexBuffer, mBufferMemory);
 		CP_DEBUG_LOG("vertex buffer destroyed");
 	}
 
 	void VertexBuffer::create(size_t size, const void* data) {
-		auto [stagingBuffer, stagingBufferMemory] = ResourceManager::createBuffer(
-			mDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-		);
-		
-		ResourceManager::fillBuffer(mDevice, stagingBufferMemory, size, data);
-
 		auto [buffer, memory] = ResourceManager::createBuffer(
 			mDevice, size,
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			mDevice.staticMemoryProperties()
 		);
 
 		mVertexBuffer = buffer;
 		mBufferMemory = memory;
 
-		ResourceManager::copyBuffer(mDevice, stagingBuffer, mVertexBuffer, size);
+		mUpload = ResourceManager::uploadBuffer(mVertexBuffer, mBufferMemory, data, size, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	}
+
+	IndexBuffer::IndexBuffer(Device& device, std::span<const uint16> indices)
+		: mDevice(device), mIndexType(VK_INDEX_TYPE_UINT16), mIndicesCount(indices.size()) {
 
-		vkDestroyBuffer(mDevice.vkDevice(), stagingBuffer, nullptr);
-		vkFreeMemory(mDevice.vkDevice(), stagingBufferMemory, nullptr);
+		create(indices.size_bytes(), indices.data());
 	}
 
-	IndexBuffer::IndexBuffer(Device& device, const std::vector<uint16>& indices)
-		: mDevice(device), mIndicesCount(indices.size()) {
+	IndexBuffer::IndexBuffer(Device& device, std::span<const uint> indices, VkIndexType indexType)
+		: mDevice(device), mIndexType(indexType), mIndicesCount(indices.size()) {
 
-		create(sizeof(uint16) * indices.size(), indices.data());
+		if (mIndexType == VK_INDEX_TYPE_UINT32) {
+			create(indices.size_bytes(), indices.data());
+			return;
+		}
+
+		std::vector<uint16> narrowed(indices.begin(), indices.end());
+		create(narrowed.size() * sizeof(uint16), narrowed.data());
 	}
 
-	IndexBuffer::~IndexBuffer() {
-		vkDestroyBuffer(mDevice.vkDevice(), mIndexBuffer, nullptr);
-		vkFreeMemory(mDevice.vkDevice(), mBufferMemory, nullptr);
-		CP_DEBUG_LOG("index buffer destroyed");
+	IndexBuffer::IndexBuffer(Device& device, const void* indices, size_t count, VkIndexType indexType)
+		: mDevice(device), mIndexType(indexType), mIndicesCount(count) {
+
+		create(count * indexSize(mIndexType), indices);
 	}
 
-	void IndexBuffer::create(size_t size, const uint16* data) {
-		auto [stagingBuffer, stagingBufferMemory] = ResourceManager::createBuffer(
-			mDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+	IndexBuffer::IndexBuffer(Device& device, size_t capacity, VkIndexType indexType)
+		: mDevice(device), mIndexType(indexType) {
+
+		auto [buffer, memory] = ResourceManager::createBuffer(
+			mDevice, indexSize(mIndexType) * std::max<size_t>(capacity, 1),
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
 		);
 
-		ResourceManager::fillBuffer(mDevice, stagingBufferMemory, size, data);
+		mIndexBuffer = buffer;
+		mBufferMemory = memory;
+
+		mMappedMemory = mBufferMemory.mapped;
+	}
+
+	IndexBuffer::~IndexBuffer() {
+		// the copy may still be reading into the buffer
+		mUpload.wait();
+		ResourceManager::destroyBuffer(mDevice, mIndexBuffer, mBufferMemory);
+		CP_DEBUG_LOG("index buffer destroyed");
+	}
 
+	void IndexBuffer::create(size_t size, const void* data) {
 		auto [buffer, memory] = ResourceManager::createBuffer(
 			mDevice, size,
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			mDevice.staticMemoryProperties()
 		);
 
 		mIndexBuffer = buffer;
 		mBufferMemory = memory;
 
-		ResourceManager::copyBuffer(mDevice, stagingBuffer, mIndexBuffer, size);
+		mUpload = ResourceManager::uploadBuffer(mIndexBuffer, mBufferMemory, data, size, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	}
+
+	InstanceBuffer::InstanceBuffer(Device& device, size_t capacity)
+		: mDevice(device), mCapacity(std::max<size_t>(capacity, 1)) {
 
-		vkDestroyBuffer(mDevice.vkDevice(), stagingBuffer, nullptr);
-		vkFreeMemory(mDevice.vkDevice(), stagingBufferMemory, nullptr);
+		create();
 	}
 
-	template<class UboT>
-	UniformBuffer<UboT>::UniformBuffer(Device& device)
-		: mDevice(device) {
+	InstanceBuffer::~InstanceBuffer() {
+		destroy();
+		CP_DEBUG_LOG("instance buffer destroyed");
+	}
+
+	void InstanceBuffer::reserve(size_t instanceCount) {
+		if (instanceCount <= mCapacity) return;
+
+		destroy();
+		while (mCapacity < instanceCount) {
+			mCapacity *= 2;
+		}
+		create();
+	}
+
+	void InstanceBuffer::create() {
+		VkDeviceSize size = sizeof(InstanceData) * mCapacity;
 
 		auto [buffer, memory] = ResourceManager::createBuffer(
-			mDevice, mSize, 
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
+			mDevice, size,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
 		);
 
-		mUniformBuffer = buffer;
+		mInstanceBuffer = buffer;
 		mBufferMemory = memory;
 
-		vkMapMemory(mDevice.vkDevice(), mBufferMemory, 0, mSize, 0, &mMappedMemory);
+		mMappedMemory = static_cast<InstanceData*>(mBufferMemory.mapped);
+	}
+
+	void InstanceBuffer::destroy() {
+		ResourceManager::destroyBuffer(mDevice, mInstanceBuffer, mBufferMemory);
+		mMappedMemory = nullptr;
+	}
+
+	IndirectBuffer::IndirectBuffer(Device& device, size_t capacity)
+		: mDevice(device), mCapacity(std::max<size_t>(capacity, 1)) {
+
+		create();
+	}
+
+	IndirectBuffer::~IndirectBuffer() {
+		destroy();
+		CP_DEBUG_LOG("indirect buffer destroyed");
 	}
 
-	template<class UboT>
-	UniformBuffer<UboT>::~UniformBuffer() {
-		vkDestroyBuffer(mDevice.vkDevice(), mUniformBuffer, nullptr);
-		vkFreeMemory(mDevice.vkDevice(), mBufferMemory, nullptr);
-		CP_DEBUG_LOG("uniform buffer destroyed");
+	void IndirectBuffer::reserve(size_t commandCount) {
+		if (commandCount <= mCapacity) return;
+
+		destroy();
+		while (mCapacity < commandCount) {
+			mCapacity *= 2;
+		}
+		create();
+	}
+
+	void IndirectBuffer::create() {
+		VkDeviceSize size = commandsSize() + sizeof(uint) * mCapacity;
+
+		auto [buffer, memory] = ResourceManager::createBuffer(
+			mDevice, size,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		mIndirectBuffer = buffer;
+		mBufferMemory = memory;
+
+		void* mapped = mBufferMemory.mapped;
+		mCommands = static_cast<VkDrawIndexedIndirectCommand*>(mapped);
+		mCounts = reinterpret_cast<uint*>(static_cast<char*>(mapped) + commandsSize());
 	}
 
-	template<class UboT>
-	void UniformBuffer<UboT>::update(const UboT& ubo) {
-		memcpy(mMappedMemory, &ubo, mSize);
+	void IndirectBuffer::destroy() {
+		ResourceManager::destroyBuffer(mDevice, mIndirectBuffer, mBufferMemory);
+		mCommands = nullptr;
+		mCounts = nullptr;
 	}
 
-	template class UniformBuffer<ProjViewUBO>;
 }
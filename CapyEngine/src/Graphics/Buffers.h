@@ -1,22 +1,37 @@
 #pragma once
 #include <Vulkan/ResourceManager.h>
+#include <Vulkan/Uploader.h>
 #include "Vertex.h"
 #include "Uniforms.h"
 
 namespace cp {
 	class VertexBuffer {
 	public:
+		// the data is staged before the constructor returns and doesn't have to outlive it
 		template <class T>
-		VertexBuffer(Device& device, const std::vector<T>& verticies) 
+		VertexBuffer(Device& device, std::span<const T> verticies) 
 			: mDevice(device), mVerticiesCount(verticies.size()) {
 
-			create(sizeof(T) * verticies.size(), reinterpret_cast<const void*>(verticies.data()));
+			create(verticies.size_bytes(), reinterpret_cast<const void*>(verticies.data()));
 		}
+
+		template <class T>
+		VertexBuffer(Device& device, const std::vector<T>& verticies)
+			: VertexBuffer(device, std::span<const T>(verticies)) {}
+
+		// host visible and persistently mapped, for geometry rewritten from the CPU
+		VertexBuffer(Device& device, size_t size);
 		
 		~VertexBuffer();
 
 		VkBuffer vkHandle() const { return mVertexBuffer; }
 		size_t vertexCount() const { return mVerticiesCount; }
+		// the buffer can be drawn from before the upload completed, graphics work is ordered after it
+		const UploadFuture& upload() const { return mUpload; }
+
+		// null unless created host visible
+		void* mapped() const { return mMappedMemory; }
+		void setVertexCount(size_t count) { mVerticiesCount = count; }
 
 	private:
 		void create(size_t size, const void* data);
@@ -24,45 +39,112 @@ namespace cp {
 	private:
 		Device& mDevice;
 		VkBuffer mVertexBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory mBufferMemory = VK_NULL_HANDLE;
+		MemoryAllocation mBufferMemory{};
+		void* mMappedMemory = nullptr;
+		UploadFuture mUpload;
 		size_t mVerticiesCount = 0;
 	};
 
+	// 16 bit indices whenever every vertex can be addressed with them, they halve the index fetch bandwidth
+	inline VkIndexType indexTypeFor(size_t vertexCount) {
+		return vertexCount <= (size_t)std::numeric_limits<uint16>::max() + 1 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+
+	inline size_t indexSize(VkIndexType type) {
+		return type == VK_INDEX_TYPE_UINT32 ? sizeof(uint) : sizeof(uint16);
+	}
+
 	class IndexBuffer {
 	public:
-		IndexBuffer(Device& device, const std::vector<uint16>& indices);
+		IndexBuffer(Device& device, std::span<const uint16> indices);
+		// narrowed to 16 bit while uploading when indexType is VK_INDEX_TYPE_UINT16
+		IndexBuffer(Device& device, std::span<const uint> indices, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+		// indices already stored in the width of indexType
+		IndexBuffer(Device& device, const void* indices, size_t count, VkIndexType indexType);
+		// host visible and persistently mapped, for geometry rewritten from the CPU
+		IndexBuffer(Device& device, size_t capacity, VkIndexType indexType = VK_INDEX_TYPE_UINT16);
 		~IndexBuffer();
 
 		VkBuffer vkHandle() const { return mIndexBuffer; }
+		VkIndexType indexType() const { return mIndexType; }
 		size_t indexCount() const { return mIndicesCount; }
+		// the buffer can be drawn from before the upload completed, graphics work is ordered after it
+		const UploadFuture& upload() const { return mUpload; }
+
+		// null unless created host visible, holds indices of indexType()
+		void* mapped() const { return mMappedMemory; }
+		void setIndexCount(size_t count) { mIndicesCount = count; }
 
 	private:
-		void create(size_t size, const uint16* data);
+		void create(size_t size, const void* data);
 
 	private:
 		Device& mDevice;
 		VkBuffer mIndexBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory mBufferMemory = VK_NULL_HANDLE;
+		MemoryAllocation mBufferMemory{};
+		void* mMappedMemory = nullptr;
+		UploadFuture mUpload;
+		VkIndexType mIndexType = VK_INDEX_TYPE_UINT16;
 		size_t mIndicesCount = 0;
 	};
 
-	template <class UboT>
-	class UniformBuffer {
+	class InstanceBuffer {
 	public:
-		UniformBuffer(Device& device);
-		~UniformBuffer();
+		InstanceBuffer(Device& device, size_t capacity);
+		~InstanceBuffer();
 
-		VkBuffer vkHandle() const { return mUniformBuffer; }
-		VkDeviceSize uboSize() const { return mSize; }
+		VkBuffer vkHandle() const { return mInstanceBuffer; }
+		size_t capacity() const { return mCapacity; }
+		InstanceData* data() const { return mMappedMemory; }
 
-		void update(const UboT& ubo);
+		// grows the buffer if needed, previous contents are not preserved
+		void reserve(size_t instanceCount);
+
+	private:
+		void create();
+		void destroy();
 
 	private:
 		Device& mDevice;
-		const VkDeviceSize mSize = sizeof(UboT);
+		size_t mCapacity = 0;
 
-		VkBuffer mUniformBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory mBufferMemory = VK_NULL_HANDLE;
-		void* mMappedMemory = nullptr;
+		VkBuffer mInstanceBuffer = VK_NULL_HANDLE;
+		MemoryAllocation mBufferMemory{};
+		InstanceData* mMappedMemory = nullptr;
 	};
+
+	// holds the indexed indirect commands followed by one draw count per group,
+	// counts are only consumed by the vkCmdDrawIndexedIndirectCount path
+	class IndirectBuffer {
+	public:
+		IndirectBuffer(Device& device, size_t capacity);
+		~IndirectBuffer();
+
+		VkBuffer vkHandle() const { return mIndirectBuffer; }
+		size_t capacity() const { return mCapacity; }
+
+		VkDrawIndexedIndirectCommand* commands() const { return mCommands; }
+		uint* counts() const { return mCounts; }
+
+		VkDeviceSize commandOffset(size_t index) const { return index * sizeof(VkDrawIndexedIndirectCommand); }
+		VkDeviceSize countOffset(size_t index) const { return commandsSize() + index * sizeof(uint); }
+		VkDeviceSize commandsSize() const { return mCapacity * sizeof(VkDrawIndexedIndirectCommand); }
+
+		// grows the buffer if needed, previous contents are not preserved
+		void reserve(size_t commandCount);
+
+	private:
+		void create();
+		void destroy();
+
+	private:
+		Device& mDevice;
+		size_t mCapacity = 0;
+
+		VkBuffer mIndirectBuffer = VK_NULL_HANDLE;
+		MemoryAllocation mBufferMemory{};
+		VkDrawIndexedIndirectCommand* mCommands = nullptr;
+		uint* mCounts = nullptr;
+	};
+
 }
@@ -0,0 +1,68 @@
+#include "ComputePipeline.h"
+
+namespace cp {
+	ComputePipeline::ComputePipeline(Device& device, const ComputePipelineConfiguration& config)
+		: mDevice(device), mConfig(config) {
+
+		create();
+	}
+
+	ComputePipeline::~ComputePipeline() {
+		vkDestroyPipeline(mDevice.vkDevice(), mPipeline, nullptr);
+		vkDestroyPipelineLayout(mDevice.vkDevice(), mPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(mDevice.vkDevice(), mDescSetLayout, nullptr);
+		CP_DEBUG_LOG("compute pipeline and layout destroyed");
+	}
+
+	void ComputePipeline::create() {
+		std::shared_ptr<const ShaderModule> shaderModule = ShaderLibrary::load(mDevice, mConfig.shaderPath);
+
+		std::vector<VkDescriptorSetLayoutBinding> descSetBindings(mConfig.descriptorBindings.size());
+		for (size_t i = 0; i < descSetBindings.size(); i++) {
+			descSetBindings[i].binding = (uint)i;
+			descSetBindings[i].descriptorCount = 1;
+			descSetBindings[i].descriptorType = mConfig.descriptorBindings[i];
+			descSetBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo descSetLayoutInfo{};
+		descSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descSetLayoutInfo.bindingCount = (uint)descSetBindings.size();
+		descSetLayoutInfo.pBindings = descSetBindings.data();
+
+		VkResult descLayoutResult = vkCreateDescriptorSetLayout(mDevice.vkDevice(), &descSetLayoutInfo, nullptr, &mDescSetLayout);
+		checkVkResult(descLayoutResult, "failed to create compute descriptor set layout");
+
+		VkPushConstantRange pcRange{};
+		pcRange.offset = 0;
+		pcRange.size = mConfig.pushConstantSize;
+		pcRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &mDescSetLayout;
+		layoutInfo.pushConstantRangeCount = mConfig.pushConstantSize > 0 ? 1 : 0;
+		layoutInfo.pPushConstantRanges = &pcRange;
+
+		VkResult layoutResult = vkCreatePipelineLayout(mDevice.vkDevice(), &layoutInfo, nullptr, &mPipelineLayout);
+		checkVkResult(layoutResult, "couldnt create compute pipeline layout");
+
+		VkPipelineShaderStageCreateInfo stageInfo{};
+		stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		stageInfo.module = shaderModule->vkHandle();
+		stageInfo.pName = "main";
+
+		VkComputePipelineCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		createInfo.stage = stageInfo;
+		createInfo.layout = mPipelineLayout;
+
+		VkResult pipelineResult = vkCreateComputePipelines(mDevice.vkDevice(), mDevice.pipelineCache(), 1, &createInfo, nullptr, &mPipeline);
+
+		// the module is only needed while the pipeline is being created, the library destroys it
+		// with its last user
+		checkVkResult(pipelineResult, "couldn't create a compute pipeline");
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <Utils.h>
+#include <Vulkan/Device.h>
+#include "ShaderLibrary.h"
+
+namespace cp {
+	struct ComputePipelineConfiguration {
+		std::filesystem::path shaderPath;
+
+		// binding i of descriptor set 0 gets descriptorBindings[i]
+		std::vector<VkDescriptorType> descriptorBindings;
+		uint pushConstantSize = 0;
+	};
+
+	class ComputePipeline {
+	public:
+		ComputePipeline(Device& device, const ComputePipelineConfiguration& config);
+		~ComputePipeline();
+
+		VkPipeline vkHandle() const { return mPipeline; }
+		VkPipelineLayout layout() const { return mPipelineLayout; }
+		VkDescriptorSetLayout descriptorSetLayout() const { return mDescSetLayout; }
+
+	private:
+		void create();
+
+	private:
+		Device& mDevice;
+		ComputePipelineConfiguration mConfig;
+
+		VkPipeline mPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout mDescSetLayout = VK_NULL_HANDLE;
+	};
+}
@@ -0,0 +1,127 @@
+#include "Culling.h"
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define CP_CULLING_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CP_CULLING_SSE
+#endif
+
+namespace cp {
+	size_t cullSpheresScalar(const Frustum& frustum, std::span<const glm::vec4> spheres, uint8_t* visibility) {
+		size_t visibleCount = 0;
+		for (size_t i = 0; i < spheres.size(); i++) {
+			const glm::vec4& sphere = spheres[i];
+
+			bool visible = true;
+			for (const glm::vec4& plane : frustum.planes) {
+				float distance = plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w;
+				visible &= distance >= -sphere.w;
+			}
+
+			visibility[i] = visible;
+			visibleCount += visible;
+		}
+		return visibleCount;
+	}
+
+#if defined(CP_CULLING_AVX2)
+	size_t cullSpheres(const Frustum& frustum, std::span<const glm::vec4> spheres, uint8_t* visibility) {
+		constexpr size_t width = 8;
+		const float* data = &spheres.data()->x;
+
+		size_t visibleCount = 0;
+		size_t i = 0;
+		for (; i + width <= spheres.size(); i += width) {
+			const float* batch = data + i * 4;
+
+			// two spheres per register, regroup so that each 128 bit lane holds four consecutive spheres
+			__m256 s01 = _mm256_loadu_ps(batch);
+			__m256 s23 = _mm256_loadu_ps(batch + 8);
+			__m256 s45 = _mm256_loadu_ps(batch + 16);
+			__m256 s67 = _mm256_loadu_ps(batch + 24);
+
+			__m256 t0 = _mm256_permute2f128_ps(s01, s45, 0x20);
+			__m256 t1 = _mm256_permute2f128_ps(s01, s45, 0x31);
+			__m256 t2 = _mm256_permute2f128_ps(s23, s67, 0x20);
+			__m256 t3 = _mm256_permute2f128_ps(s23, s67, 0x31);
+
+			// in lane 4x4 transpose into x, y, z and radius of spheres 0..7
+			__m256 u0 = _mm256_unpacklo_ps(t0, t1);
+			__m256 u1 = _mm256_unpackhi_ps(t0, t1);
+			__m256 u2 = _mm256_unpacklo_ps(t2, t3);
+			__m256 u3 = _mm256_unpackhi_ps(t2, t3);
+
+			__m256 x = _mm256_shuffle_ps(u0, u2, _MM_SHUFFLE(1, 0, 1, 0));
+			__m256 y = _mm256_shuffle_ps(u0, u2, _MM_SHUFFLE(3, 2, 3, 2));
+			__m256 z = _mm256_shuffle_ps(u1, u3, _MM_SHUFFLE(1, 0, 1, 0));
+			__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_shuffle_ps(u1, u3, _MM_SHUFFLE(3, 2, 3, 2)));
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes) {
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+					_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w))
+				);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+
+			uint mask = (uint)_mm256_movemask_ps(inside);
+			for (size_t lane = 0; lane < width; lane++) {
+				visibility[i + lane] = (mask >> lane) & 1;
+			}
+			visibleCount += std::popcount(mask);
+		}
+
+		return visibleCount + cullSpheresScalar(frustum, spheres.subspan(i), visibility + i);
+	}
+
+	const char* cullingInstructionSet() { return "AVX2"; }
+
+#elif defined(CP_CULLING_SSE)
+	size_t cullSpheres(const Frustum& frustum, std::span<const glm::vec4> spheres, uint8_t* visibility) {
+		constexpr size_t width = 4;
+		const float* data = &spheres.data()->x;
+
+		size_t visibleCount = 0;
+		size_t i = 0;
+		for (; i + width <= spheres.size(); i += width) {
+			const float* batch = data + i * 4;
+
+			__m128 x = _mm_loadu_ps(batch);
+			__m128 y = _mm_loadu_ps(batch + 4);
+			__m128 z = _mm_loadu_ps(batch + 8);
+			__m128 radius = _mm_loadu_ps(batch + 12);
+			_MM_TRANSPOSE4_PS(x, y, z, radius);
+			__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w))
+				);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			uint mask = (uint)_mm_movemask_ps(inside);
+			for (size_t lane = 0; lane < width; lane++) {
+				visibility[i + lane] = (mask >> lane) & 1;
+			}
+			visibleCount += std::popcount(mask);
+		}
+
+		return visibleCount + cullSpheresScalar(frustum, spheres.subspan(i), visibility + i);
+	}
+
+	const char* cullingInstructionSet() { return "SSE2"; }
+
+#else
+	size_t cullSpheres(const Frustum& frustum, std::span<const glm::vec4> spheres, uint8_t* visibility) {
+		return cullSpheresScalar(frustum, spheres, visibility);
+	}
+
+	const char* cullingInstructionSet() { return "scalar"; }
+#endif
+}
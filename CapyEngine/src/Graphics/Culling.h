@@ -0,0 +1,16 @@
+#pragma once
+#include "Bounds.h"
+
+namespace cp {
+	// Batched frustum tests of world space bounding spheres packed as (center, radius).
+	// visibility[i] is set to 1 when sphere i intersects the frustum and 0 otherwise,
+	// the number of visible spheres is returned.
+	// Uses AVX2 when the engine is compiled with it (CAPY_ENABLE_AVX2), SSE on other x86 targets
+	// and a scalar loop elsewhere.
+	size_t cullSpheres(const Frustum& frustum, std::span<const glm::vec4> spheres, uint8_t* visibility);
+
+	// reference implementation, also used for the remainder that doesn't fill a SIMD register
+	size_t cullSpheresScalar(const Frustum& frustum, std::span<const glm::vec4> spheres, uint8_t* visibility);
+
+	const char* cullingInstructionSet();
+}
@@ -0,0 +1,149 @@
+#include "CullingPass.h"
+
+namespace cp {
+	CullingPass::CullingPass(Device& device, uint framesInFlight, const std::filesystem::path& shaderPath)
+		: mDevice(device) {
+
+		ComputePipelineConfiguration config{};
+		config.shaderPath = shaderPath;
+		config.descriptorBindings = {
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // cull objects
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // instance data
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // indirect commands
+		};
+		config.pushConstantSize = sizeof(PushConstants);
+		mPipeline = std::make_unique<ComputePipeline>(mDevice, config);
+
+		mFrames.resize(framesInFlight);
+		for (uint i = 0; i < framesInFlight; i++) {
+			createFrameBuffer(i);
+		}
+		createDescriptorSets(framesInFlight);
+	}
+
+	CullingPass::~CullingPass() {
+		for (uint i = 0; i < mFrames.size(); i++) {
+			destroyFrameBuffer(i);
+		}
+		vkDestroyDescriptorPool(mDevice.vkDevice(), mDescriptorPool, nullptr);
+		CP_DEBUG_LOG("culling pass destroyed");
+	}
+
+	void CullingPass::reserve(uint frame, size_t objectCount) {
+		FrameResources& resources = mFrames[frame];
+		if (objectCount <= resources.capacity) return;
+
+		destroyFrameBuffer(frame);
+		while (resources.capacity < objectCount) {
+			resources.capacity *= 2;
+		}
+		createFrameBuffer(frame);
+	}
+
+	void CullingPass::record(
+		VkCommandBuffer cmd,
+		uint frame,
+		const glm::mat4& projView,
+		uint objectCount,
+		const InstanceBuffer& instanceBuffer,
+		const IndirectBuffer& indirectBuffer
+	) {
+		if (objectCount == 0) return;
+		const FrameResources& resources = mFrames[frame];
+
+		// buffers may have been reallocated since the last frame, the set is not in use since the frame fence was waited on
+		std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+		bufferInfos[0] = { resources.buffer, 0, sizeof(CullObject) * resources.capacity };
+		bufferInfos[1] = { instanceBuffer.vkHandle(), 0, sizeof(InstanceData) * instanceBuffer.capacity() };
+		bufferInfos[2] = { indirectBuffer.vkHandle(), 0, indirectBuffer.commandsSize() };
+
+		std::array<VkWriteDescriptorSet, 3> descWrites{};
+		for (uint i = 0; i < descWrites.size(); i++) {
+			descWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descWrites[i].dstSet = resources.descriptorSet;
+			descWrites[i].dstBinding = i;
+			descWrites[i].dstArrayElement = 0;
+			descWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descWrites[i].descriptorCount = 1;
+			descWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(mDevice.vkDevice(), (uint)descWrites.size(), descWrites.data(), 0, nullptr);
+
+		PushConstants pushConstants{};
+		pushConstants.planes = Frustum::fromMatrix(projView).planes;
+		pushConstants.objectCount = objectCount;
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline->vkHandle());
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline->layout(), 0, 1, &resources.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(cmd, mPipeline->layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+		vkCmdDispatch(cmd, (objectCount + sWorkgroupSize - 1) / sWorkgroupSize, 1, 1);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+		vkCmdPipelineBarrier(
+			cmd,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr
+		);
+	}
+
+	void CullingPass::createDescriptorSets(uint framesInFlight) {
+		VkDescriptorPoolSize poolSize{};
+		poolSize.descriptorCount = framesInFlight * 3;
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = framesInFlight;
+
+		VkResult poolResult = vkCreateDescriptorPool(mDevice.vkDevice(), &poolInfo, nullptr, &mDescriptorPool);
+		checkVkResult(poolResult, "failed to create culling descriptor pool");
+
+		std::vector<VkDescriptorSetLayout> layouts(framesInFlight, mPipeline->descriptorSetLayout());
+		std::vector<VkDescriptorSet> sets(framesInFlight);
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = mDescriptorPool;
+		allocInfo.descriptorSetCount = framesInFlight;
+		allocInfo.pSetLayouts = layouts.data();
+
+		VkResult setResult = vkAllocateDescriptorSets(mDevice.vkDevice(), &allocInfo, sets.data());
+		checkVkResult(setResult, "failed to allocate culling descriptor sets");
+
+		for (uint i = 0; i < framesInFlight; i++) {
+			mFrames[i].descriptorSet = sets[i];
+		}
+	}
+
+	void CullingPass::createFrameBuffer(uint frame) {
+		FrameResources& resources = mFrames[frame];
+		VkDeviceSize size = sizeof(CullObject) * resources.capacity;
+
+		auto [buffer, memory] = ResourceManager::createBuffer(
+			mDevice, size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		resources.buffer = buffer;
+		resources.memory = memory;
+
+		resources.objects = static_cast<CullObject*>(resources.memory.mapped);
+	}
+
+	void CullingPass::destroyFrameBuffer(uint frame) {
+		FrameResources& resources = mFrames[frame];
+		ResourceManager::destroyBuffer(mDevice, resources.buffer, resources.memory);
+		resources.objects = nullptr;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "ComputePipeline.h"
+#include "Buffers.h"
+#include "Bounds.h"
+
+namespace cp {
+	// std430 layout of one element of the culling input buffer
+	struct CullObject {
+		glm::mat4 model{1.f};
+		glm::vec4 sphere{0.f}; // local center and radius
+		uint command = skip; // indirect command receiving the instance if visible
+		uint padding[3]{};
+
+		static constexpr uint skip = (uint)(-1);
+	};
+
+	// compute pass testing object bounding spheres against the frustum and compacting
+	// the visible ones into the instance buffer, instance counts are accumulated into the
+	// indirect commands (which have to start from zero) with atomics
+	class CullingPass {
+	public:
+		CullingPass(Device& device, uint framesInFlight, const std::filesystem::path& shaderPath);
+		~CullingPass();
+
+		// grows the input buffer of the frame, previous contents are not preserved
+		void reserve(uint frame, size_t objectCount);
+		CullObject* objects(uint frame) const { return mFrames[frame].objects; }
+
+		// records the dispatch and the barrier making its results visible to indirect draws,
+		// has to be recorded outside of a render pass
+		void record(
+			VkCommandBuffer cmd,
+			uint frame,
+			const glm::mat4& projView,
+			uint objectCount,
+			const InstanceBuffer& instanceBuffer,
+			const IndirectBuffer& indirectBuffer
+		);
+
+	private:
+		void createDescriptorSets(uint framesInFlight);
+		void createFrameBuffer(uint frame);
+		void destroyFrameBuffer(uint frame);
+
+	private:
+		struct PushConstants {
+			std::array<glm::vec4, 6> planes;
+			uint objectCount;
+		};
+
+		struct FrameResources {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			MemoryAllocation memory{};
+			CullObject* objects = nullptr;
+			size_t capacity = 256;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		};
+
+		static constexpr uint sWorkgroupSize = 64;
+
+		Device& mDevice;
+		std::unique_ptr<ComputePipeline> mPipeline;
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		std::vector<FrameResources> mFrames;
+	};
+}
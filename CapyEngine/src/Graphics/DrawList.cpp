@@ -0,0 +1,68 @@
+#include "DrawList.h"
+
+namespace cp {
+	uint64 DrawList::makeSortKey(uint pipeline, uint mesh, float depth, uint scope) {
+		// bit pattern of a non negative float grows with its value, so the top bits can be compared as an integer
+		uint depthBits = std::bit_cast<uint>(std::max(depth, 0.f)) >> 8;
+
+		return
+			((uint64)(scope & 0x3F) << 58) |
+			((uint64)(pipeline & 0x3FFF) << 44) |
+			((uint64)(mesh & 0xFFFFF) << 24) |
+			(uint64)(depthBits & 0xFFFFFF);
+	}
+
+	void DrawList::add(const DrawPacket& packet) {
+		mEntries.push_back({ packet.sortKey, (uint)mPackets.size() });
+		mPackets.push_back(packet);
+	}
+
+	void DrawList::retain(const std::vector<uint8_t>& keep) {
+		CP_ASSERT(keep.size() == mPackets.size(), "retain flags don't match the packet count");
+
+		size_t kept = 0;
+		for (size_t i = 0; i < mPackets.size(); i++) {
+			if (!keep[i]) continue;
+
+			mPackets[kept] = mPackets[i];
+			mEntries[kept] = { mPackets[kept].sortKey, (uint)kept };
+			kept++;
+		}
+
+		mPackets.resize(kept);
+		mEntries.resize(kept);
+	}
+
+	void DrawList::sort() {
+		if (mEntries.size() < 2) return;
+
+		mScratch.resize(mEntries.size());
+
+		// LSD radix sort, one byte per pass, passes where every key has the same byte are skipped
+		for (uint shift = 0; shift < 64; shift += 8) {
+			std::array<size_t, 256> offsets{};
+			for (const SortEntry& entry : mEntries) {
+				offsets[(entry.key >> shift) & 0xFF]++;
+			}
+
+			if (offsets[(mEntries[0].key >> shift) & 0xFF] == mEntries.size()) continue;
+
+			size_t sum = 0;
+			for (size_t& offset : offsets) {
+				size_t count = offset;
+				offset = sum;
+				sum += count;
+			}
+
+			for (const SortEntry& entry : mEntries) {
+				mScratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+			}
+			mEntries.swap(mScratch);
+		}
+	}
+
+	void DrawList::clear() {
+		mPackets.clear();
+		mEntries.clear();
+	}
+}
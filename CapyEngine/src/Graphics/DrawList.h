@@ -0,0 +1,63 @@
+#pragma once
+#include "Buffers.h"
+#include "Bounds.h"
+
+namespace cp {
+	// buffers and ranges read by one indexed draw, pooled meshes share their buffers
+	struct DrawGeometry {
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+		uint indexCount = 0;
+		uint firstIndex = 0;
+		int vertexOffset = 0;
+
+		bool operator==(const DrawGeometry&) const = default;
+	};
+
+	struct DrawPacket {
+		uint64 sortKey = 0;
+		uint pipeline = 0;
+		uint scope = 0; // gpu profiler scope, 0 when not inside one
+		uint drawData = 0; // dynamic offset of the per-draw uniform in the frame ring buffer
+		DrawGeometry geometry{};
+		glm::mat4 model{1.f};
+		BoundingSphere bounds{}; // local space
+	};
+
+	// Packets submitted between Renderer::begin and Renderer::end, sorted by a 64 bit key
+	// before being recorded so that state changes don't depend on submission order.
+	// Key layout, most significant first: scope (6 bits) | pipeline (14 bits) | mesh (20 bits) | view depth (24 bits),
+	// packets of one profiler scope stay contiguous so they can be wrapped in a single pair of timestamps
+	class DrawList {
+	public:
+		static uint64 makeSortKey(uint pipeline, uint mesh, float depth, uint scope = 0);
+
+		void add(const DrawPacket& packet);
+		void sort();
+		void clear();
+
+		// drops packets whose flag is 0, flags are in submission order so this has to run before sort()
+		void retain(const std::vector<uint8_t>& keep);
+
+		size_t size() const { return mPackets.size(); }
+		bool empty() const { return mPackets.empty(); }
+
+		// packets in submission order
+		const std::vector<DrawPacket>& packets() const { return mPackets; }
+
+		// valid after sort(), returns packets in sorted order
+		const DrawPacket& operator[](size_t idx) const { return mPackets[mEntries[idx].packetIdx]; }
+
+	private:
+		struct SortEntry {
+			uint64 key;
+			uint packetIdx;
+		};
+
+	private:
+		std::vector<DrawPacket> mPackets;
+		std::vector<SortEntry> mEntries;
+		std::vector<SortEntry> mScratch;
+	};
+}
@@ -0,0 +1,54 @@
+#include "FrameRingBuffer.h"
+
+namespace cp {
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	FrameRingBuffer::FrameRingBuffer(Device& device, uint framesInFlight, VkDeviceSize frameSize, VkDeviceSize maxRange, VkBufferUsageFlags usage)
+		: mDevice(device) {
+
+		const VkPhysicalDeviceLimits& limits = mDevice.properties().limits;
+		mAlignment = 16;
+		if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+			mAlignment = std::max(mAlignment, limits.minUniformBufferOffsetAlignment);
+		}
+		if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+			mAlignment = std::max(mAlignment, limits.minStorageBufferOffsetAlignment);
+		}
+
+		// region starts stay aligned so offsets inside every frame are aligned as well
+		mFrameSize = alignUp(frameSize, mAlignment);
+		VkDeviceSize size = mFrameSize * framesInFlight + maxRange;
+
+		auto [buffer, memory] = ResourceManager::createBuffer(
+			mDevice, size, usage,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		mBuffer = buffer;
+		mBufferMemory = memory;
+
+		mMappedMemory = static_cast<char*>(mBufferMemory.mapped);
+	}
+
+	FrameRingBuffer::~FrameRingBuffer() {
+		ResourceManager::destroyBuffer(mDevice, mBuffer, mBufferMemory);
+		CP_DEBUG_LOG("frame ring buffer destroyed");
+	}
+
+	void FrameRingBuffer::beginFrame(uint frame) {
+		mFrameStart = mFrameSize * frame;
+		mHead = mFrameStart;
+	}
+
+	RingAllocation FrameRingBuffer::allocate(VkDeviceSize size) {
+		VkDeviceSize offset = alignUp(mHead, mAlignment);
+		if (offset + size > mFrameStart + mFrameSize) {
+			throw std::runtime_error("frame ring buffer is full, increase its frame size");
+		}
+
+		mHead = offset + size;
+		return { mMappedMemory + offset, (uint)offset };
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <Vulkan/ResourceManager.h>
+
+namespace cp {
+	struct RingAllocation {
+		void* data = nullptr;
+		// offset from the start of the buffer, passed as the dynamic offset when binding
+		uint offset = 0;
+	};
+
+	// one persistently mapped buffer split into a region per frame in flight, allocations are
+	// bumped linearly through the region of the current frame and all of them are released
+	// together when the frame slot comes around again
+	class FrameRingBuffer {
+	public:
+		// maxRange is the largest descriptor range bound at an allocation, the end of the
+		// buffer is padded by it so dynamic offsets near the end stay in bounds
+		FrameRingBuffer(Device& device, uint framesInFlight, VkDeviceSize frameSize, VkDeviceSize maxRange, VkBufferUsageFlags usage);
+		~FrameRingBuffer();
+
+		VkBuffer vkHandle() const { return mBuffer; }
+		VkDeviceSize frameSize() const { return mFrameSize; }
+		VkDeviceSize alignment() const { return mAlignment; }
+		// bytes allocated in the current frame
+		VkDeviceSize used() const { return mHead - mFrameStart; }
+
+		// the fence of the frame has to be waited on before
+		void beginFrame(uint frame);
+
+		// throws when the frame region is exhausted
+		RingAllocation allocate(VkDeviceSize size);
+
+		template <class T>
+		uint push(const T& value) {
+			RingAllocation allocation = allocate(sizeof(T));
+			memcpy(allocation.data, &value, sizeof(T));
+			return allocation.offset;
+		}
+
+	private:
+		Device& mDevice;
+		VkDeviceSize mFrameSize = 0;
+		VkDeviceSize mAlignment = 0;
+		VkDeviceSize mFrameStart = 0;
+		VkDeviceSize mHead = 0;
+
+		VkBuffer mBuffer = VK_NULL_HANDLE;
+		MemoryAllocation mBufferMemory{};
+		char* mMappedMemory = nullptr;
+	};
+}
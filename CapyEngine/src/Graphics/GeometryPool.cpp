@@ -0,0 +1,304 @@
+#include "GeometryPool.h"
+
+namespace cp {
+	void RangeFreeList::reset(size_t capacity, size_t used) {
+		CP_ASSERT(used <= capacity, "free list can't use more than its capacity");
+
+		mRanges.clear();
+		mCapacity = capacity;
+		mAvailable = capacity - used;
+		if (mAvailable > 0) {
+			mRanges.emplace(used, mAvailable);
+		}
+	}
+
+	bool RangeFreeList::allocate(size_t count, size_t& offset) {
+		CP_ASSERT(count > 0, "can't allocate an empty range");
+
+		for (auto it = mRanges.begin(); it != mRanges.end(); it++) {
+			if (it->second < count) continue;
+
+			offset = it->first;
+			size_t remaining = it->second - count;
+			mRanges.erase(it);
+			if (remaining > 0) {
+				mRanges.emplace(offset + count, remaining);
+			}
+			mAvailable -= count;
+			return true;
+		}
+		return false;
+	}
+
+	void RangeFreeList::free(size_t offset, size_t count) {
+		mAvailable += count;
+
+		auto next = mRanges.lower_bound(offset);
+		if (next != mRanges.end() && offset + count == next->first) {
+			count += next->second;
+			next = mRanges.erase(next);
+		}
+
+		if (next != mRanges.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				prev->second += count;
+				return;
+			}
+		}
+		mRanges.emplace(offset, count);
+	}
+
+	size_t RangeFreeList::largestRange() const {
+		size_t largest = 0;
+		for (const auto& [offset, count] : mRanges) {
+			largest = std::max(largest, count);
+		}
+		return largest;
+	}
+
+	template<class VertexT>
+	GeometryPool<VertexT>::GeometryPool(
+		Device& device,
+		size_t vertexCapacity,
+		size_t indexCapacity,
+		VkIndexType indexType,
+		uint retireFrames
+	)
+		: mDevice(device), mIndexType(indexType), mRetireFrames(retireFrames) {
+
+		createBuffers(std::max<size_t>(vertexCapacity, 1), std::max<size_t>(indexCapacity, 1));
+		mVertexRanges.reset(std::max<size_t>(vertexCapacity, 1));
+		mIndexRanges.reset(std::max<size_t>(indexCapacity, 1));
+	}
+
+	template<class VertexT>
+	GeometryPool<VertexT>::~GeometryPool() {
+		// the copies may still be writing into the buffers
+		mUpload.wait();
+		ResourceManager::destroyBuffer(mDevice, mVertexBuffer.buffer, mVertexBuffer.memory);
+		ResourceManager::destroyBuffer(mDevice, mIndexBuffer.buffer, mIndexBuffer.memory);
+		CP_DEBUG_LOG("geometry pool destroyed");
+	}
+
+	template<class VertexT>
+	uint GeometryPool<VertexT>::allocate(std::span<const VertexT> vertices, std::span<const uint16> indices) {
+		if (mIndexType == VK_INDEX_TYPE_UINT16) {
+			return allocateRange(vertices, indices.data(), indices.size());
+		}
+
+		std::vector<uint> widened(indices.begin(), indices.end());
+		return allocateRange(vertices, widened.data(), widened.size());
+	}
+
+	template<class VertexT>
+	uint GeometryPool<VertexT>::allocate(std::span<const VertexT> vertices, std::span<const uint> indices) {
+		if (mIndexType == VK_INDEX_TYPE_UINT32) {
+			return allocateRange(vertices, indices.data(), indices.size());
+		}
+
+		CP_ASSERT(indexTypeFor(vertices.size()) == VK_INDEX_TYPE_UINT16, "mesh has too many vertices for a pool with 16 bit indices");
+		std::vector<uint16> narrowed(indices.begin(), indices.end());
+		return allocateRange(vertices, narrowed.data(), narrowed.size());
+	}
+
+	template<class VertexT>
+	uint GeometryPool<VertexT>::allocateRange(std::span<const VertexT> vertices, const void* indices, size_t indexCount) {
+		CP_ASSERT(!vertices.empty() && indexCount > 0, "can't allocate an empty mesh from a geometry pool");
+
+		size_t vertexOffset = 0;
+		size_t firstIndex = 0;
+		auto tryAllocate = [&]() {
+			if (!mVertexRanges.allocate(vertices.size(), vertexOffset)) return false;
+			if (!mIndexRanges.allocate(indexCount, firstIndex)) {
+				mVertexRanges.free(vertexOffset, vertices.size());
+				return false;
+			}
+			return true;
+		};
+
+		if (!tryAllocate()) {
+			// compacting alone is enough when the free space is only fragmented
+			size_t vertexCapacity = mVertexRanges.capacity();
+			size_t indexCapacity = mIndexRanges.capacity();
+			while (vertexCapacity < mLiveVertices + vertices.size()) vertexCapacity *= 2;
+			while (indexCapacity < mLiveIndices + indexCount) indexCapacity *= 2;
+
+			rebuild(vertexCapacity, indexCapacity);
+			bool allocated = tryAllocate();
+			CP_ASSERT(allocated, "geometry pool has no room after compaction");
+		}
+
+		uint id;
+		if (!mFreeAllocationIds.empty()) {
+			id = mFreeAllocationIds.back();
+			mFreeAllocationIds.pop_back();
+		}
+		else {
+			id = (uint)mAllocations.size();
+			mAllocations.emplace_back();
+			mFreed.push_back(0);
+		}
+
+		GeometryRange& range = mAllocations[id];
+		range.vertexOffset = (uint)vertexOffset;
+		range.vertexCount = (uint)vertices.size();
+		range.firstIndex = (uint)firstIndex;
+		range.indexCount = (uint)indexCount;
+
+		mLiveAllocations++;
+		mLiveVertices += range.vertexCount;
+		mLiveIndices += range.indexCount;
+
+		// the ranges were free, nothing in flight reads them. Frames do read the rest of the buffers,
+		// which are concurrent so the copies don't move their ownership away from the graphics queue
+		size_t indexBytes = indexSize(mIndexType);
+		mUpload = ResourceManager::uploadBuffer(
+			mVertexBuffer.buffer, mVertexBuffer.memory,
+			vertices.data(), vertices.size_bytes(),
+			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			vertexOffset * sizeof(VertexT), BufferSharing::Concurrent
+		);
+		mUpload = ResourceManager::uploadBuffer(
+			mIndexBuffer.buffer, mIndexBuffer.memory,
+			indices, indexCount * indexBytes,
+			VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			firstIndex * indexBytes, BufferSharing::Concurrent
+		);
+		return id;
+	}
+
+	template<class VertexT>
+	void GeometryPool<VertexT>::free(uint allocation) {
+		CP_ASSERT(allocation < mAllocations.size() && mAllocations[allocation].vertexCount > 0, "invalid geometry pool allocation");
+		CP_ASSERT(!mFreed[allocation], "geometry pool allocation freed twice");
+		mFreed[allocation] = 1;
+
+		const GeometryRange& range = mAllocations[allocation];
+		mLiveAllocations--;
+		mLiveVertices -= range.vertexCount;
+		mLiveIndices -= range.indexCount;
+		mPendingFrees.push_back({ allocation, mFrame });
+	}
+
+	template<class VertexT>
+	void GeometryPool<VertexT>::advance() {
+		mFrame++;
+		while (!mPendingFrees.empty() && mFrame - mPendingFrees.front().frame >= mRetireFrames) {
+			release(mPendingFrees.front().allocation);
+			mPendingFrees.pop_front();
+		}
+	}
+
+	template<class VertexT>
+	void GeometryPool<VertexT>::compact() {
+		rebuild(mVertexRanges.capacity(), mIndexRanges.capacity());
+	}
+
+	template<class VertexT>
+	DrawGeometry GeometryPool<VertexT>::geometry(uint allocation) const {
+		const GeometryRange& range = mAllocations[allocation];
+
+		DrawGeometry geometry{};
+		geometry.vertexBuffer = mVertexBuffer.buffer;
+		geometry.indexBuffer = mIndexBuffer.buffer;
+		geometry.indexType = mIndexType;
+		geometry.indexCount = range.indexCount;
+		geometry.firstIndex = range.firstIndex;
+		geometry.vertexOffset = (int)range.vertexOffset;
+		return geometry;
+	}
+
+	template<class VertexT>
+	GeometryPoolStatistics GeometryPool<VertexT>::statistics() const {
+		GeometryPoolStatistics stats{};
+		stats.allocations = mLiveAllocations;
+		stats.vertexCapacity = mVertexRanges.capacity();
+		stats.verticesUsed = mLiveVertices;
+		stats.indexCapacity = mIndexRanges.capacity();
+		stats.indicesUsed = mLiveIndices;
+		stats.pendingFrees = mPendingFrees.size();
+		stats.compactions = mCompactions;
+		return stats;
+	}
+
+	template<class VertexT>
+	void GeometryPool<VertexT>::release(uint allocation) {
+		GeometryRange& range = mAllocations[allocation];
+		mVertexRanges.free(range.vertexOffset, range.vertexCount);
+		mIndexRanges.free(range.firstIndex, range.indexCount);
+
+		range = {};
+		mFreed[allocation] = 0;
+		mFreeAllocationIds.push_back(allocation);
+	}
+
+	template<class VertexT>
+	void GeometryPool<VertexT>::rebuild(size_t vertexCapacity, size_t indexCapacity) {
+		// queued copies into the old buffers have to land before they are copied over
+		ResourceManager::uploader().wait();
+		mDevice.wait();
+
+		// nothing is in flight anymore
+		while (!mPendingFrees.empty()) {
+			release(mPendingFrees.front().allocation);
+			mPendingFrees.pop_front();
+		}
+
+		Buffer oldVertexBuffer = mVertexBuffer;
+		Buffer oldIndexBuffer = mIndexBuffer;
+		createBuffers(vertexCapacity, indexCapacity);
+
+		// live ranges are packed in allocation order, indices are relative to their first vertex and stay valid
+		size_t indexBytes = indexSize(mIndexType);
+		std::vector<VkBufferCopy> vertexCopies;
+		std::vector<VkBufferCopy> indexCopies;
+		size_t vertexCursor = 0;
+		size_t indexCursor = 0;
+
+		for (GeometryRange& range : mAllocations) {
+			if (range.vertexCount == 0) continue;
+
+			vertexCopies.push_back({ range.vertexOffset * sizeof(VertexT), vertexCursor * sizeof(VertexT), range.vertexCount * sizeof(VertexT) });
+			indexCopies.push_back({ range.firstIndex * indexBytes, indexCursor * indexBytes, range.indexCount * indexBytes });
+
+			range.vertexOffset = (uint)vertexCursor;
+			range.firstIndex = (uint)indexCursor;
+			vertexCursor += range.vertexCount;
+			indexCursor += range.indexCount;
+		}
+
+		ResourceManager::copyBuffer(mDevice, oldVertexBuffer.buffer, mVertexBuffer.buffer, vertexCopies);
+		ResourceManager::copyBuffer(mDevice, oldIndexBuffer.buffer, mIndexBuffer.buffer, indexCopies);
+
+		ResourceManager::destroyBuffer(mDevice, oldVertexBuffer.buffer, oldVertexBuffer.memory);
+		ResourceManager::destroyBuffer(mDevice, oldIndexBuffer.buffer, oldIndexBuffer.memory);
+
+		mVertexRanges.reset(vertexCapacity, vertexCursor);
+		mIndexRanges.reset(indexCapacity, indexCursor);
+		mCompactions++;
+
+		CP_DEBUG_LOG("geometry pool compacted, %zu vertices, %zu indices", vertexCapacity, indexCapacity);
+	}
+
+	template<class VertexT>
+	void GeometryPool<VertexT>::createBuffers(size_t vertexCapacity, size_t indexCapacity) {
+		VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		mVertexBuffer = ResourceManager::createBuffer(
+			mDevice, sizeof(VertexT) * vertexCapacity,
+			transferUsage | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			mDevice.staticMemoryProperties(),
+			BufferSharing::Concurrent
+		);
+		mIndexBuffer = ResourceManager::createBuffer(
+			mDevice, indexSize(mIndexType) * indexCapacity,
+			transferUsage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			mDevice.staticMemoryProperties(),
+			BufferSharing::Concurrent
+		);
+	}
+
+	template class GeometryPool<PositionColorVertex>;
+	template class GeometryPool<SpriteVertex>;
+}
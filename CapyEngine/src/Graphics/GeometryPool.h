@@ -0,0 +1,121 @@
+#pragma once
+#include <Vulkan/ResourceManager.h>
+#include <Vulkan/Uploader.h>
+#include "Vertex.h"
+#include "DrawList.h"
+
+namespace cp {
+	// first fit allocator of element ranges, free ranges are kept sorted and merged with their neighbours
+	class RangeFreeList {
+	public:
+		void reset(size_t capacity, size_t used = 0);
+
+		// returns false when no free range is large enough
+		bool allocate(size_t count, size_t& offset);
+		void free(size_t offset, size_t count);
+
+		size_t capacity() const { return mCapacity; }
+		size_t available() const { return mAvailable; }
+		size_t largestRange() const;
+
+	private:
+		// offset -> count
+		std::map<size_t, size_t> mRanges;
+		size_t mCapacity = 0;
+		size_t mAvailable = 0;
+	};
+
+	// location of one mesh in the pool, indices are relative to vertexOffset
+	struct GeometryRange {
+		uint vertexOffset = 0;
+		uint vertexCount = 0;
+		uint firstIndex = 0;
+		uint indexCount = 0;
+	};
+
+	struct GeometryPoolStatistics {
+		size_t allocations = 0;
+		size_t vertexCapacity = 0;
+		size_t verticesUsed = 0;
+		size_t indexCapacity = 0;
+		size_t indicesUsed = 0;
+		// ranges freed but possibly still read by frames in flight
+		size_t pendingFrees = 0;
+		uint compactions = 0;
+	};
+
+	// One device local vertex buffer and one index buffer shared by many meshes of the same vertex type,
+	// so that the renderer binds them once and merges the draws of different meshes into one indirect call.
+	// Freed ranges are reused only retireFrames calls to advance() later, when no frame in flight reads them
+	// anymore. An allocation that doesn't fit compacts the live ranges to the start of new buffers, growing
+	// them when needed, this waits for the device and must not happen between Renderer::begin and end.
+	template <class VertexT>
+	class GeometryPool {
+	public:
+		GeometryPool(
+			Device& device,
+			size_t vertexCapacity,
+			size_t indexCapacity,
+			VkIndexType indexType = VK_INDEX_TYPE_UINT16,
+			uint retireFrames = 3
+		);
+		~GeometryPool();
+
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		// returns an allocation id, indices are converted to the index type of the pool
+		uint allocate(std::span<const VertexT> vertices, std::span<const uint16> indices);
+		uint allocate(std::span<const VertexT> vertices, std::span<const uint> indices);
+		void free(uint allocation);
+
+		// call once per frame, releases the ranges freed retireFrames frames ago
+		void advance();
+		// moves the live ranges next to each other, offsets of allocations change
+		void compact();
+
+		// valid until the next allocation, compaction may move the range
+		const GeometryRange& range(uint allocation) const { return mAllocations[allocation]; }
+		DrawGeometry geometry(uint allocation) const;
+
+		VkBuffer vertexBuffer() const { return mVertexBuffer.buffer; }
+		VkBuffer indexBuffer() const { return mIndexBuffer.buffer; }
+		VkIndexType indexType() const { return mIndexType; }
+		GeometryPoolStatistics statistics() const;
+
+	private:
+		struct PendingFree {
+			uint allocation;
+			uint frame;
+		};
+
+		uint allocateRange(std::span<const VertexT> vertices, const void* indices, size_t indexCount);
+		void release(uint allocation);
+		void rebuild(size_t vertexCapacity, size_t indexCapacity);
+		void createBuffers(size_t vertexCapacity, size_t indexCapacity);
+
+	private:
+		Device& mDevice;
+		VkIndexType mIndexType;
+		uint mRetireFrames;
+		uint mFrame = 0;
+
+		Buffer mVertexBuffer{};
+		Buffer mIndexBuffer{};
+		RangeFreeList mVertexRanges;
+		RangeFreeList mIndexRanges;
+
+		std::vector<GeometryRange> mAllocations;
+		// set by free, the range stays allocated until release once no frame reads it anymore
+		std::vector<uint8_t> mFreed;
+		std::vector<uint> mFreeAllocationIds;
+		std::deque<PendingFree> mPendingFrees;
+		size_t mLiveAllocations = 0;
+		size_t mLiveVertices = 0;
+		size_t mLiveIndices = 0;
+		uint mCompactions = 0;
+
+		// batches complete in order, the latest upload covers all earlier ones
+		UploadFuture mUpload;
+	};
+}
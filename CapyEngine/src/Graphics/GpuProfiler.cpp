@@ -0,0 +1,167 @@
+#include "GpuProfiler.h"
+
+namespace cp {
+	GpuProfiler::GpuProfiler(Device& device, uint framesInFlight, uint maxScopes, bool pipelineStatistics)
+		: mDevice(device),
+		mMaxScopes(maxScopes),
+		mTimestampCount(FirstScope + maxScopes * 2),
+		mStatisticsEnabled(pipelineStatistics && device.features().pipelineStatisticsQuery),
+		mTimestampPeriod(device.properties().limits.timestampPeriod),
+		mTimestampMask(device.timestampValidBits() < 64 ? (1ull << device.timestampValidBits()) - 1 : ~0ull) {
+
+		CP_ASSERT(device.timestampValidBits() > 0, "the graphics queue doesn't support timestamps");
+
+		if (pipelineStatistics && !mStatisticsEnabled) {
+			CP_DEBUG_LOG("pipeline statistics queries are not supported by the device");
+		}
+
+		mFrames.resize(framesInFlight);
+		for (FrameQueries& queries : mFrames) {
+			VkQueryPoolCreateInfo timestampInfo{};
+			timestampInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			timestampInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			timestampInfo.queryCount = mTimestampCount;
+
+			VkResult timestampResult = vkCreateQueryPool(mDevice.vkDevice(), &timestampInfo, nullptr, &queries.timestampPool);
+			checkVkResult(timestampResult, "failed to create timestamp query pool");
+
+			if (!mStatisticsEnabled) continue;
+
+			VkQueryPoolCreateInfo statisticsInfo{};
+			statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			statisticsInfo.queryCount = 1;
+			statisticsInfo.pipelineStatistics = sStatisticsFlags;
+
+			VkResult statisticsResult = vkCreateQueryPool(mDevice.vkDevice(), &statisticsInfo, nullptr, &queries.statisticsPool);
+			checkVkResult(statisticsResult, "failed to create pipeline statistics query pool");
+		}
+	}
+
+	GpuProfiler::~GpuProfiler() {
+		for (FrameQueries& queries : mFrames) {
+			vkDestroyQueryPool(mDevice.vkDevice(), queries.timestampPool, nullptr);
+			if (queries.statisticsPool != VK_NULL_HANDLE) {
+				vkDestroyQueryPool(mDevice.vkDevice(), queries.statisticsPool, nullptr);
+			}
+		}
+		CP_DEBUG_LOG("query pools destroyed");
+	}
+
+	void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint frame) {
+		FrameQueries& queries = mFrames[frame];
+		if (queries.submitted) {
+			resolve(frame);
+		}
+
+		queries.scopeNames.clear();
+		queries.frame = mFrameCounter++;
+		queries.submitted = true;
+
+		vkCmdResetQueryPool(cmd, queries.timestampPool, 0, mTimestampCount);
+		if (mStatisticsEnabled) {
+			vkCmdResetQueryPool(cmd, queries.statisticsPool, 0, 1);
+		}
+		writeTimestamp(cmd, frame, FrameBegin, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+
+	void GpuProfiler::endFrame(VkCommandBuffer cmd, uint frame) {
+		writeTimestamp(cmd, frame, FrameEnd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+
+	uint GpuProfiler::addScope(uint frame, std::string_view name) {
+		std::vector<std::string>& names = mFrames[frame].scopeNames;
+		if (names.size() >= mMaxScopes) {
+			CP_DEBUG_ERROR("gpu scope '%.*s' dropped, all %u scopes of the frame are used", (int)name.size(), name.data(), mMaxScopes);
+			return 0;
+		}
+
+		names.emplace_back(name);
+		return (uint)names.size();
+	}
+
+	void GpuProfiler::beginScope(VkCommandBuffer cmd, uint frame, uint scope) const {
+		writeTimestamp(cmd, frame, FirstScope + (scope - 1) * 2, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+
+	void GpuProfiler::endScope(VkCommandBuffer cmd, uint frame, uint scope) const {
+		writeTimestamp(cmd, frame, FirstScope + (scope - 1) * 2 + 1, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+
+	void GpuProfiler::writeTimestamp(VkCommandBuffer cmd, uint frame, uint query, VkPipelineStageFlagBits stage) const {
+		vkCmdWriteTimestamp(cmd, stage, mFrames[frame].timestampPool, query);
+	}
+
+	void GpuProfiler::beginPipelineStatistics(VkCommandBuffer cmd, uint frame) const {
+		if (!mStatisticsEnabled) return;
+		vkCmdBeginQuery(cmd, mFrames[frame].statisticsPool, 0, 0);
+	}
+
+	void GpuProfiler::endPipelineStatistics(VkCommandBuffer cmd, uint frame) const {
+		if (!mStatisticsEnabled) return;
+		vkCmdEndQuery(cmd, mFrames[frame].statisticsPool, 0);
+	}
+
+	void GpuProfiler::resolve(uint frame) {
+		const FrameQueries& queries = mFrames[frame];
+
+		// pairs of (value, availability), queries that were never written (empty scopes) stay unavailable
+		std::vector<uint64> timestamps(mTimestampCount * 2);
+		vkGetQueryPoolResults(
+			mDevice.vkDevice(), queries.timestampPool,
+			0, mTimestampCount,
+			timestamps.size() * sizeof(uint64), timestamps.data(),
+			sizeof(uint64) * 2,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+		);
+
+		auto available = [&](uint query) { return timestamps[query * 2 + 1] != 0; };
+		auto value = [&](uint query) { return timestamps[query * 2]; };
+
+		if (!available(FrameBegin) || !available(FrameEnd)) return;
+
+		GpuFrameTimings timings{};
+		timings.valid = true;
+		timings.frame = queries.frame;
+		timings.frameTimeMs = timestampDeltaMs(value(FrameBegin), value(FrameEnd));
+
+		if (available(RenderPassBegin) && available(RenderPassEnd)) {
+			timings.renderPassTimeMs = timestampDeltaMs(value(RenderPassBegin), value(RenderPassEnd));
+		}
+
+		for (uint i = 0; i < queries.scopeNames.size(); i++) {
+			uint beginQuery = FirstScope + i * 2;
+			if (!available(beginQuery) || !available(beginQuery + 1)) continue;
+
+			timings.scopes.push_back({ queries.scopeNames[i], timestampDeltaMs(value(beginQuery), value(beginQuery + 1)) });
+		}
+
+		if (mStatisticsEnabled) {
+			// results are written in the order of the flag bits
+			std::array<uint64, 6> statistics{};
+			VkResult statisticsResult = vkGetQueryPoolResults(
+				mDevice.vkDevice(), queries.statisticsPool,
+				0, 1,
+				sizeof(statistics), statistics.data(),
+				sizeof(statistics),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+			);
+
+			if (statisticsResult == VK_SUCCESS && statistics[5] != 0) {
+				timings.hasPipelineStatistics = true;
+				timings.pipelineStatistics.inputAssemblyVertices = statistics[0];
+				timings.pipelineStatistics.vertexShaderInvocations = statistics[1];
+				timings.pipelineStatistics.clippingPrimitives = statistics[2];
+				timings.pipelineStatistics.fragmentShaderInvocations = statistics[3];
+				timings.pipelineStatistics.computeShaderInvocations = statistics[4];
+			}
+		}
+
+		mLatest = std::move(timings);
+	}
+
+	float GpuProfiler::timestampDeltaMs(uint64 begin, uint64 end) const {
+		// only the valid bits count up, masking the difference keeps it right across a wraparound
+		return (float)((double)((end - begin) & mTimestampMask) * mTimestampPeriod / 1e6);
+	}
+}
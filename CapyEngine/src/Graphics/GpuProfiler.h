@@ -0,0 +1,97 @@
+#pragma once
+#include <Vulkan/Device.h>
+
+namespace cp {
+	struct GpuPipelineStatistics {
+		uint64 inputAssemblyVertices = 0;
+		uint64 vertexShaderInvocations = 0;
+		uint64 clippingPrimitives = 0;
+		uint64 fragmentShaderInvocations = 0;
+		uint64 computeShaderInvocations = 0;
+	};
+
+	struct GpuScopeTiming {
+		std::string name;
+		float timeMs = 0.f;
+	};
+
+	// GPU side results of one frame, resolved framesInFlight frames after it was submitted
+	struct GpuFrameTimings {
+		bool valid = false;
+		uint64 frame = 0;
+
+		float frameTimeMs = 0.f;
+		float renderPassTimeMs = 0.f;
+		// scopes that had no draws in the frame are left out
+		std::vector<GpuScopeTiming> scopes;
+
+		bool hasPipelineStatistics = false;
+		GpuPipelineStatistics pipelineStatistics{};
+	};
+
+	// per frame in flight timestamp and pipeline statistics query pools,
+	// results are read when the frame slot is reused so the CPU never waits on them
+	class GpuProfiler {
+	public:
+		enum Timestamp : uint {
+			FrameBegin,
+			FrameEnd,
+			RenderPassBegin,
+			RenderPassEnd,
+			FirstScope,
+		};
+
+		GpuProfiler(Device& device, uint framesInFlight, uint maxScopes, bool pipelineStatistics);
+		~GpuProfiler();
+
+		// resolves the queries of the last frame recorded into this slot and resets them,
+		// the frame fence has to be waited on before
+		void beginFrame(VkCommandBuffer cmd, uint frame);
+		void endFrame(VkCommandBuffer cmd, uint frame);
+
+		// returns the scope id (1 based) or 0 when all scopes of the frame are used
+		uint addScope(uint frame, std::string_view name);
+		void beginScope(VkCommandBuffer cmd, uint frame, uint scope) const;
+		void endScope(VkCommandBuffer cmd, uint frame, uint scope) const;
+
+		void writeTimestamp(VkCommandBuffer cmd, uint frame, uint query, VkPipelineStageFlagBits stage) const;
+
+		bool pipelineStatisticsEnabled() const { return mStatisticsEnabled; }
+		VkQueryPipelineStatisticFlags pipelineStatisticsFlags() const { return mStatisticsEnabled ? sStatisticsFlags : 0; }
+		void beginPipelineStatistics(VkCommandBuffer cmd, uint frame) const;
+		void endPipelineStatistics(VkCommandBuffer cmd, uint frame) const;
+
+		const GpuFrameTimings& latest() const { return mLatest; }
+
+	private:
+		void resolve(uint frame);
+		float timestampDeltaMs(uint64 begin, uint64 end) const;
+
+	private:
+		struct FrameQueries {
+			VkQueryPool timestampPool = VK_NULL_HANDLE;
+			VkQueryPool statisticsPool = VK_NULL_HANDLE;
+			std::vector<std::string> scopeNames;
+			uint64 frame = 0;
+			bool submitted = false;
+		};
+
+		static constexpr VkQueryPipelineStatisticFlags sStatisticsFlags =
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+		Device& mDevice;
+		uint mMaxScopes;
+		uint mTimestampCount;
+		bool mStatisticsEnabled;
+		float mTimestampPeriod;
+		uint64 mTimestampMask;
+		uint64 mFrameCounter = 0;
+
+		std::vector<FrameQueries> mFrames;
+		GpuFrameTimings mLatest{};
+	};
+}
@@ -2,13 +2,342 @@
 #include <Application.h>
 
 namespace cp {
+	static uint nextMeshId() {
+		static std::atomic<uint> sCounter = 0;
+		return sCounter++;
+	}
+
+	template<class VertexT>
+	static void computeBounds(
+		std::span<const VertexT> vertices,
+		AABB& aabb,
+		BoundingSphere& sphere,
+		const VertexQuantization& quantization = {}
+	) {
+		aabb = {};
+		sphere = {};
+		if (vertices.empty()) return;
+
+		aabb.min = vertexPosition(vertices[0], quantization);
+		aabb.max = aabb.min;
+		for (const VertexT& vertex : vertices) {
+			glm::vec3 position = vertexPosition(vertex, quantization);
+			aabb.min = glm::min(aabb.min, position);
+			aabb.max = glm::max(aabb.max, position);
+		}
+
+		// centered on the AABB, not minimal but cheap and tight enough for culling
+		sphere.center = aabb.center();
+		for (const VertexT& vertex : vertices) {
+			sphere.radius = std::max(sphere.radius, glm::length(vertexPosition(vertex, quantization) - sphere.center));
+		}
+	}
+
 	template<class VertexT>
-	Mesh<VertexT>::Mesh(const std::vector<VertexT>& vertices, const std::vector<uint16>& indices) : 
+	Mesh<VertexT>::Mesh(
+		std::span<const VertexT> vertices, std::span<const uint16> indices,
+		MeshCpuData cpuData, const VertexQuantization& quantization
+	) :
 		mDevice(Application::get().device()),
-		mVertices(vertices), mIndices(indices),
-		mVertexBuffer(mDevice, mVertices), 
-		mIndexBuffer(mDevice, mIndices) {}
+		mId(nextMeshId()),
+		mCpuData(cpuData),
+		mQuantization(quantization),
+		mVertexBuffer(mDevice, vertices),
+		mIndexBuffer(mDevice, indices) {
+
+		if (mCpuData == MeshCpuData::Retain) {
+			mVertices.assign(vertices.begin(), vertices.end());
+			mIndices.assign(indices.begin(), indices.end());
+		}
+		mLods.push_back({ 0, (uint)indices.size(), 0.f });
+		computeBounds(vertices, mAABB, mBoundingSphere, mQuantization);
+	}
+
+	template<class VertexT>
+	Mesh<VertexT>::Mesh(
+		std::vector<VertexT>&& vertices, std::vector<uint16>&& indices,
+		MeshCpuData cpuData, const VertexQuantization& quantization
+	) :
+		Mesh(std::span<const VertexT>(vertices), std::span<const uint16>(indices), MeshCpuData::Release, quantization) {
+
+		// the buffers staged their data already
+		mCpuData = cpuData;
+		if (mCpuData == MeshCpuData::Retain) {
+			mVertices = std::move(vertices);
+			mIndices = std::move(indices);
+		}
+		else {
+			std::vector<VertexT>().swap(vertices);
+			std::vector<uint16>().swap(indices);
+		}
+	}
+
+	template<class VertexT>
+	Mesh<VertexT>::Mesh(
+		std::span<const VertexT> vertices, std::span<const uint> indices,
+		MeshCpuData cpuData, const VertexQuantization& quantization
+	) :
+		mDevice(Application::get().device()),
+		mId(nextMeshId()),
+		mCpuData(cpuData),
+		mQuantization(quantization),
+		mVertexBuffer(mDevice, vertices),
+		mIndexBuffer(mDevice, indices, indexTypeFor(vertices.size())) {
+
+		if (mCpuData == MeshCpuData::Retain) {
+			mVertices.assign(vertices.begin(), vertices.end());
+			mIndices32.assign(indices.begin(), indices.end());
+		}
+		mLods.push_back({ 0, (uint)indices.size(), 0.f });
+		computeBounds(vertices, mAABB, mBoundingSphere, mQuantization);
+	}
+
+	template<class VertexT>
+	Mesh<VertexT>::Mesh(
+		std::vector<VertexT>&& vertices, std::vector<uint>&& indices,
+		MeshCpuData cpuData, const VertexQuantization& quantization
+	) :
+		Mesh(std::span<const VertexT>(vertices), std::span<const uint>(indices), MeshCpuData::Release, quantization) {
+
+		mCpuData = cpuData;
+		if (mCpuData == MeshCpuData::Retain) {
+			mVertices = std::move(vertices);
+			mIndices32 = std::move(indices);
+		}
+		else {
+			std::vector<VertexT>().swap(vertices);
+			std::vector<uint>().swap(indices);
+		}
+	}
+
+	template<class VertexT>
+	Mesh<VertexT>::Mesh(
+		std::span<const VertexT> vertices, const LodChain& lodChain,
+		MeshCpuData cpuData, const VertexQuantization& quantization
+	) :
+		Mesh(vertices, std::span<const uint>(lodChain.indices), cpuData, quantization) {
+
+		CP_ASSERT(!lodChain.lods.empty(), "LOD chain has no levels");
+		mLods = lodChain.lods;
+	}
+
+	template<class VertexT>
+	Mesh<VertexT>::Mesh(const MeshFile& file, MeshCpuData cpuData) :
+		mDevice(Application::get().device()),
+		mId(nextMeshId()),
+		mCpuData(cpuData),
+		mQuantization(file.header().quantization),
+		mVertexBuffer(mDevice, file.vertices<VertexT>()),
+		mIndexBuffer(mDevice, file.indexData(), file.indexCount(), file.indexType()),
+		mLods(file.lods().begin(), file.lods().end()),
+		mAABB(file.header().aabb),
+		mBoundingSphere(file.header().boundingSphere) {
+
+		if (mCpuData == MeshCpuData::Retain) {
+			std::span<const VertexT> vertices = file.vertices<VertexT>();
+			mVertices.assign(vertices.begin(), vertices.end());
+
+			if (file.indexType() == VK_INDEX_TYPE_UINT16) {
+				const uint16* indices = static_cast<const uint16*>(file.indexData());
+				mIndices.assign(indices, indices + file.indexCount());
+			}
+			else {
+				const uint* indices = static_cast<const uint*>(file.indexData());
+				mIndices32.assign(indices, indices + file.indexCount());
+			}
+		}
+	}
+
+	template<class VertexT>
+	DrawGeometry Mesh<VertexT>::geometry(uint lod) const {
+		const MeshLod& level = mLods[lod];
+
+		DrawGeometry geometry{};
+		geometry.vertexBuffer = mVertexBuffer.vkHandle();
+		geometry.indexBuffer = mIndexBuffer.vkHandle();
+		geometry.indexType = mIndexBuffer.indexType();
+		geometry.indexCount = level.indexCount;
+		geometry.firstIndex = level.firstIndex;
+		return geometry;
+	}
 
 	template class Mesh<PositionColorVertex>;
 	template class Mesh<SpriteVertex>;
+	template class Mesh<PackedPositionColorVertex>;
+	template class Mesh<PackedSpriteVertex>;
+
+	template<class PackedT, class VertexT, class IndexT>
+	static std::unique_ptr<Mesh<PackedT>> packVertices(std::span<const VertexT> vertices, std::span<const IndexT> indices, MeshCpuData cpuData) {
+		AABB bounds{};
+		BoundingSphere sphere{};
+		computeBounds(vertices, bounds, sphere);
+		VertexQuantization quantization = VertexQuantization::fromBounds(bounds.min, bounds.max);
+
+		std::vector<PackedT> packed;
+		packed.reserve(vertices.size());
+		for (const VertexT& vertex : vertices) {
+			packed.push_back(PackedT::pack(vertex, quantization));
+		}
+		return std::make_unique<Mesh<PackedT>>(std::span<const PackedT>(packed), indices, cpuData, quantization);
+	}
+
+	std::unique_ptr<Mesh<PackedPositionColorVertex>> packMesh(std::span<const PositionColorVertex> vertices, std::span<const uint16> indices, MeshCpuData cpuData) {
+		return packVertices<PackedPositionColorVertex>(vertices, indices, cpuData);
+	}
+
+	std::unique_ptr<Mesh<PackedPositionColorVertex>> packMesh(std::span<const PositionColorVertex> vertices, std::span<const uint> indices, MeshCpuData cpuData) {
+		return packVertices<PackedPositionColorVertex>(vertices, indices, cpuData);
+	}
+
+	std::unique_ptr<Mesh<PackedSpriteVertex>> packMesh(std::span<const SpriteVertex> vertices, std::span<const uint16> indices, MeshCpuData cpuData) {
+		return packVertices<PackedSpriteVertex>(vertices, indices, cpuData);
+	}
+
+	std::unique_ptr<Mesh<PackedSpriteVertex>> packMesh(std::span<const SpriteVertex> vertices, std::span<const uint> indices, MeshCpuData cpuData) {
+		return packVertices<PackedSpriteVertex>(vertices, indices, cpuData);
+	}
+
+	template<class VertexT>
+	void DynamicMesh<VertexT>::DirtyRange::add(size_t rangeFirst, size_t rangeLast) {
+		if (rangeFirst >= rangeLast) return;
+
+		if (empty()) {
+			first = rangeFirst;
+			last = rangeLast;
+		}
+		else {
+			first = std::min(first, rangeFirst);
+			last = std::max(last, rangeLast);
+		}
+	}
+
+	template<class VertexT>
+	DynamicMesh<VertexT>::DynamicMesh(size_t vertexCapacity, size_t indexCapacity, uint frameSlots) :
+		mDevice(Application::get().device()),
+		mId(nextMeshId()),
+		mVertices(vertexCapacity), mIndices(indexCapacity) {
+
+		CP_ASSERT(frameSlots > 0, "dynamic mesh needs at least one frame slot");
+
+		mSlots.resize(frameSlots);
+		for (FrameSlot& slot : mSlots) {
+			slot.vertexBuffer = std::make_unique<VertexBuffer>(mDevice, sizeof(VertexT) * vertexCapacity);
+			slot.indexBuffer = std::make_unique<IndexBuffer>(mDevice, indexCapacity);
+			slot.vertexBuffer->setVertexCount(0);
+			slot.indexBuffer->setIndexCount(0);
+		}
+	}
+
+	template<class VertexT>
+	void DynamicMesh<VertexT>::updateVertices(std::span<const VertexT> vertices, size_t offset) {
+		CP_ASSERT(offset + vertices.size() <= mVertices.size(), "dynamic mesh vertex capacity exceeded");
+
+		std::copy(vertices.begin(), vertices.end(), mVertices.begin() + offset);
+		mVertexCount = std::max(mVertexCount, offset + vertices.size());
+
+		for (FrameSlot& slot : mSlots) {
+			slot.vertices.add(offset, offset + vertices.size());
+		}
+		mBoundsDirty = true;
+	}
+
+	template<class VertexT>
+	void DynamicMesh<VertexT>::updateIndices(std::span<const uint16> indices, size_t offset) {
+		CP_ASSERT(offset + indices.size() <= mIndices.size(), "dynamic mesh index capacity exceeded");
+
+		std::copy(indices.begin(), indices.end(), mIndices.begin() + offset);
+		mIndexCount = std::max(mIndexCount, offset + indices.size());
+
+		for (FrameSlot& slot : mSlots) {
+			slot.indices.add(offset, offset + indices.size());
+		}
+	}
+
+	template<class VertexT>
+	void DynamicMesh<VertexT>::resize(size_t vertexCount, size_t indexCount) {
+		CP_ASSERT(vertexCount <= mVertices.size() && indexCount <= mIndices.size(), "dynamic mesh capacity exceeded");
+
+		// growing exposes elements the slots may not have received yet
+		for (FrameSlot& slot : mSlots) {
+			slot.vertices.add(mVertexCount, vertexCount);
+			slot.indices.add(mIndexCount, indexCount);
+		}
+
+		mBoundsDirty = mBoundsDirty || vertexCount != mVertexCount;
+		mVertexCount = vertexCount;
+		mIndexCount = indexCount;
+	}
+
+	template<class VertexT>
+	void DynamicMesh<VertexT>::advance() {
+		mCurrentSlot = (mCurrentSlot + 1) % (uint)mSlots.size();
+		FrameSlot& slot = mSlots[mCurrentSlot];
+
+		// memory is coherent, the writes are visible to the next queue submission
+		if (!slot.vertices.empty()) {
+			VertexT* mapped = static_cast<VertexT*>(slot.vertexBuffer->mapped());
+			std::copy(mVertices.begin() + slot.vertices.first, mVertices.begin() + slot.vertices.last, mapped + slot.vertices.first);
+			slot.vertices = {};
+		}
+
+		if (!slot.indices.empty()) {
+			uint16* mapped = static_cast<uint16*>(slot.indexBuffer->mapped());
+			std::copy(mIndices.begin() + slot.indices.first, mIndices.begin() + slot.indices.last, mapped + slot.indices.first);
+			slot.indices = {};
+		}
+
+		slot.vertexBuffer->setVertexCount(mVertexCount);
+		slot.indexBuffer->setIndexCount(mIndexCount);
+
+		if (mBoundsDirty) {
+			updateBounds();
+		}
+	}
+
+	template<class VertexT>
+	void DynamicMesh<VertexT>::updateBounds() {
+		mBoundsDirty = false;
+		computeBounds(std::span<const VertexT>(mVertices.data(), mVertexCount), mAABB, mBoundingSphere);
+	}
+
+	template<class VertexT>
+	DrawGeometry DynamicMesh<VertexT>::geometry() const {
+		const FrameSlot& slot = mSlots[mCurrentSlot];
+
+		DrawGeometry geometry{};
+		geometry.vertexBuffer = slot.vertexBuffer->vkHandle();
+		geometry.indexBuffer = slot.indexBuffer->vkHandle();
+		geometry.indexType = slot.indexBuffer->indexType();
+		geometry.indexCount = (uint)slot.indexBuffer->indexCount();
+		return geometry;
+	}
+
+	template class DynamicMesh<PositionColorVertex>;
+	template class DynamicMesh<SpriteVertex>;
+
+	template<class VertexT>
+	PooledMesh<VertexT>::PooledMesh(GeometryPool<VertexT>& pool, std::span<const VertexT> vertices, std::span<const uint16> indices) :
+		mPool(pool),
+		mId(nextMeshId()),
+		mAllocation(pool.allocate(vertices, indices)) {
+
+		computeBounds(vertices, mAABB, mBoundingSphere);
+	}
+
+	template<class VertexT>
+	PooledMesh<VertexT>::PooledMesh(GeometryPool<VertexT>& pool, std::span<const VertexT> vertices, std::span<const uint> indices) :
+		mPool(pool),
+		mId(nextMeshId()),
+		mAllocation(pool.allocate(vertices, indices)) {
+
+		computeBounds(vertices, mAABB, mBoundingSphere);
+	}
+
+	template<class VertexT>
+	PooledMesh<VertexT>::~PooledMesh() {
+		mPool.free(mAllocation);
+	}
+
+	template class PooledMesh<PositionColorVertex>;
+	template class PooledMesh<SpriteVertex>;
 }
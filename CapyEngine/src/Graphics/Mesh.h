@@ -1,24 +1,197 @@
 #pragma once
 #include "Buffers.h"
 #include "Vertex.h"
+#include "Bounds.h"
+#include "DrawList.h"
+#include "GeometryPool.h"
+#include "MeshSimplifier.h"
+#include "MeshFile.h"
 
 namespace cp {
+	// whether a mesh keeps its geometry in host memory after the upload
+	enum class MeshCpuData {
+		Retain,
+		Release
+	};
+
 	template <class VertexT>
 	class Mesh {
 	public:
-		Mesh(const std::vector<VertexT>& vertices, const std::vector<uint16>& indices);
+		// copies the data only when it's retained, packed vertex layouts need the quantization they were packed with
+		Mesh(
+			std::span<const VertexT> vertices, std::span<const uint16> indices,
+			MeshCpuData cpuData = MeshCpuData::Retain, const VertexQuantization& quantization = {}
+		);
+		// takes the vectors over, they are freed right after the upload when released
+		Mesh(
+			std::vector<VertexT>&& vertices, std::vector<uint16>&& indices,
+			MeshCpuData cpuData = MeshCpuData::Retain, const VertexQuantization& quantization = {}
+		);
+
+		// uploaded as 16 bit indices when the vertex count allows it
+		Mesh(
+			std::span<const VertexT> vertices, std::span<const uint> indices,
+			MeshCpuData cpuData = MeshCpuData::Retain, const VertexQuantization& quantization = {}
+		);
+		Mesh(
+			std::vector<VertexT>&& vertices, std::vector<uint>&& indices,
+			MeshCpuData cpuData = MeshCpuData::Retain, const VertexQuantization& quantization = {}
+		);
+
+		// every level of the chain draws from the same vertex buffer and a range of the one index buffer
+		Mesh(
+			std::span<const VertexT> vertices, const LodChain& lodChain,
+			MeshCpuData cpuData = MeshCpuData::Retain, const VertexQuantization& quantization = {}
+		);
+
+		// uploads straight from the mapping, bounds, LODs and quantization are taken from the header
+		// and the file can be closed once the mesh is constructed
+		explicit Mesh(const MeshFile& file, MeshCpuData cpuData = MeshCpuData::Release);
 
 		VertexBuffer& vertexBuffer() const { return mVertexBuffer; }
 		IndexBuffer& indexBuffer() const { return mIndexBuffer; }
+		uint id() const { return mId; }
+		// in mesh space, also for packed vertex layouts
+		const AABB& aabb() const { return mAABB; }
+		const BoundingSphere& boundingSphere() const { return mBoundingSphere; }
+		// identity for full precision layouts
+		const VertexQuantization& quantization() const { return mQuantization; }
 		
-		std::vector<VertexT> vertices() const { return mVertices; }
-		std::vector<uint16> indices() const { return mIndices; }
+		size_t vertexCount() const { return mVertexBuffer.vertexCount(); }
+		size_t indexCount() const { return mIndexBuffer.indexCount(); }
+		VkIndexType indexType() const { return mIndexBuffer.indexType(); }
+		DrawGeometry geometry(uint lod = 0) const;
+		// ordered from full detail to coarsest, a single level for meshes created without a chain
+		std::span<const MeshLod> lods() const { return mLods; }
+
+		// empty when the mesh was created with MeshCpuData::Release
+		bool hasCpuData() const { return mCpuData == MeshCpuData::Retain; }
+		std::span<const VertexT> vertices() const { return mVertices; }
+		// retained in the width they were passed in, only one of them is filled
+		std::span<const uint16> indices() const { return mIndices; }
+		std::span<const uint> indices32() const { return mIndices32; }
 
 	private:
 		Device& mDevice;
+		uint mId;
+		MeshCpuData mCpuData;
+		VertexQuantization mQuantization;
 		std::vector<VertexT> mVertices;
 		std::vector<uint16> mIndices;
+		std::vector<uint> mIndices32;
 		mutable VertexBuffer mVertexBuffer;
 		mutable IndexBuffer mIndexBuffer;
+		std::vector<MeshLod> mLods;
+		AABB mAABB{};
+		BoundingSphere mBoundingSphere{};
+	};
+
+	// Quantizes full precision vertices into the packed layouts, positions are stored relative to the mesh bounds.
+	// Vertex fetch shrinks from 28 to 12 bytes (36 to 16 for sprites), precision is 1/65535 of the largest extent.
+	std::unique_ptr<Mesh<PackedPositionColorVertex>> packMesh(
+		std::span<const PositionColorVertex> vertices, std::span<const uint16> indices, MeshCpuData cpuData = MeshCpuData::Retain
+	);
+	std::unique_ptr<Mesh<PackedPositionColorVertex>> packMesh(
+		std::span<const PositionColorVertex> vertices, std::span<const uint> indices, MeshCpuData cpuData = MeshCpuData::Retain
+	);
+	std::unique_ptr<Mesh<PackedSpriteVertex>> packMesh(
+		std::span<const SpriteVertex> vertices, std::span<const uint16> indices, MeshCpuData cpuData = MeshCpuData::Retain
+	);
+	std::unique_ptr<Mesh<PackedSpriteVertex>> packMesh(
+		std::span<const SpriteVertex> vertices, std::span<const uint> indices, MeshCpuData cpuData = MeshCpuData::Retain
+	);
+
+	// Geometry rewritten from the CPU. Every frame slot owns host visible, persistently mapped
+	// vertex and index buffers, so writing the next slot never touches buffers the GPU may
+	// still be reading and nothing waits on the queue. Updates go to a CPU copy first and
+	// each slot receives the ranges that changed since it was last used.
+	template <class VertexT>
+	class DynamicMesh {
+	public:
+		// slots have to outnumber the renderer's frames in flight by one when the mesh
+		// is updated before Renderer::begin waits on the frame fence
+		DynamicMesh(size_t vertexCapacity, size_t indexCapacity, uint frameSlots = 3);
+
+		// offset + data.size() may grow the mesh up to its capacity
+		void updateVertices(std::span<const VertexT> vertices, size_t offset = 0);
+		void updateIndices(std::span<const uint16> indices, size_t offset = 0);
+		void resize(size_t vertexCount, size_t indexCount);
+
+		// switches to the next frame slot and copies the pending ranges into it,
+		// call once per frame after the updates and before submitting the mesh
+		void advance();
+
+		VertexBuffer& vertexBuffer() const { return *mSlots[mCurrentSlot].vertexBuffer; }
+		IndexBuffer& indexBuffer() const { return *mSlots[mCurrentSlot].indexBuffer; }
+		uint id() const { return mId; }
+		const AABB& aabb() const { return mAABB; }
+		const BoundingSphere& boundingSphere() const { return mBoundingSphere; }
+
+		size_t vertexCount() const { return mVertexCount; }
+		size_t indexCount() const { return mIndexCount; }
+		// buffers of the current frame slot
+		DrawGeometry geometry() const;
+		size_t vertexCapacity() const { return mVertices.size(); }
+		size_t indexCapacity() const { return mIndices.size(); }
+
+	private:
+		struct DirtyRange {
+			size_t first = 0;
+			size_t last = 0;
+
+			bool empty() const { return first >= last; }
+			void add(size_t rangeFirst, size_t rangeLast);
+		};
+
+		struct FrameSlot {
+			std::unique_ptr<VertexBuffer> vertexBuffer;
+			std::unique_ptr<IndexBuffer> indexBuffer;
+			DirtyRange vertices;
+			DirtyRange indices;
+		};
+
+		void updateBounds();
+
+	private:
+		Device& mDevice;
+		uint mId;
+		std::vector<VertexT> mVertices;
+		std::vector<uint16> mIndices;
+		size_t mVertexCount = 0;
+		size_t mIndexCount = 0;
+
+		std::vector<FrameSlot> mSlots;
+		uint mCurrentSlot = 0;
+
+		bool mBoundsDirty = false;
+		AABB mAABB{};
+		BoundingSphere mBoundingSphere{};
+	};
+
+	// Mesh stored as a range of a GeometryPool, the pool has to outlive it. The range is
+	// handed back to the pool on destruction and reused once frames in flight are done with it.
+	template <class VertexT>
+	class PooledMesh {
+	public:
+		PooledMesh(GeometryPool<VertexT>& pool, std::span<const VertexT> vertices, std::span<const uint16> indices);
+		PooledMesh(GeometryPool<VertexT>& pool, std::span<const VertexT> vertices, std::span<const uint> indices);
+		~PooledMesh();
+
+		PooledMesh(const PooledMesh&) = delete;
+		PooledMesh& operator=(const PooledMesh&) = delete;
+
+		uint id() const { return mId; }
+		const AABB& aabb() const { return mAABB; }
+		const BoundingSphere& boundingSphere() const { return mBoundingSphere; }
+
+		const GeometryRange& range() const { return mPool.range(mAllocation); }
+		DrawGeometry geometry() const { return mPool.geometry(mAllocation); }
+
+	private:
+		GeometryPool<VertexT>& mPool;
+		uint mId;
+		uint mAllocation;
+		AABB mAABB{};
+		BoundingSphere mBoundingSphere{};
 	};
 }
@@ -0,0 +1,115 @@
+#include "MeshFile.h"
+#include "Mesh.h"
+
+namespace cp {
+	static uint64 alignOffset(uint64 offset) {
+		return (offset + MeshFileHeader::alignment - 1) & ~(MeshFileHeader::alignment - 1);
+	}
+
+	MeshFile::MeshFile(const std::filesystem::path& path)
+		: mPath(path), mFile(path) {
+
+		auto fail = [&](const std::string& reason) {
+			throw std::runtime_error("invalid mesh file '" + mPath.string() + "': " + reason);
+		};
+
+		if (mFile.size() < sizeof(MeshFileHeader)) fail("too small for a header");
+		mHeader = reinterpret_cast<const MeshFileHeader*>(mFile.data());
+
+		if (mHeader->magic != MeshFileHeader::magicValue) fail("not a mesh file");
+		if (mHeader->version != MeshFileHeader::currentVersion) fail("unsupported version " + std::to_string(mHeader->version));
+		if (mHeader->fileSize != mFile.size()) fail("truncated");
+		if (mHeader->attributeCount > MeshFileHeader::maxAttributes) fail("too many vertex attributes");
+		if (mHeader->indexType != VK_INDEX_TYPE_UINT16 && mHeader->indexType != VK_INDEX_TYPE_UINT32) fail("unknown index type");
+		if (mHeader->lodCount == 0) fail("no LODs");
+
+		if (mHeader->vertexStride == 0) fail("zero vertex stride");
+
+		// divides instead of multiplying, a huge count can't wrap around and pass
+		auto blobFits = [&](uint64 offset, uint64 count, uint64 elementSize) {
+			return offset % MeshFileHeader::alignment == 0 && offset >= sizeof(MeshFileHeader) && offset <= mFile.size() && count <= (mFile.size() - offset) / elementSize;
+		};
+		if (!blobFits(mHeader->lodsOffset, mHeader->lodCount, sizeof(MeshLod))) fail("LODs out of bounds");
+		if (!blobFits(mHeader->verticesOffset, mHeader->vertexCount, mHeader->vertexStride)) fail("vertices out of bounds");
+		if (!blobFits(mHeader->indicesOffset, mHeader->indexCount, indexSize(indexType()))) fail("indices out of bounds");
+
+		for (const MeshLod& lod : lods()) {
+			if ((uint64)lod.firstIndex + lod.indexCount > mHeader->indexCount) fail("LOD range out of bounds");
+		}
+	}
+
+	std::span<const MeshLod> MeshFile::lods() const {
+		return { reinterpret_cast<const MeshLod*>(mFile.data() + mHeader->lodsOffset), mHeader->lodCount };
+	}
+
+	template<class VertexT>
+	void writeMeshFile(const std::filesystem::path& path, const Mesh<VertexT>& mesh) {
+		if (!mesh.hasCpuData()) {
+			throw std::runtime_error("can't write mesh file '" + path.string() + "', the mesh released its CPU data");
+		}
+
+		// the indices are stored in the width the GPU uses
+		std::vector<uint16> narrowed;
+		const void* indexData = mesh.indices().data();
+		if (!mesh.indices32().empty()) {
+			indexData = mesh.indices32().data();
+			if (mesh.indexType() == VK_INDEX_TYPE_UINT16) {
+				narrowed.assign(mesh.indices32().begin(), mesh.indices32().end());
+				indexData = narrowed.data();
+			}
+		}
+
+		MeshFileHeader header{};
+		VkVertexInputBindingDescription binding = VertexT::bindingDescription();
+		AttributeDescriptions attributes = VertexT::attributeDescriptions();
+		CP_ASSERT(attributes.size() <= MeshFileHeader::maxAttributes, "vertex type has more attributes than a mesh file can describe");
+
+		header.vertexStride = binding.stride;
+		header.attributeCount = (uint)attributes.size();
+		for (size_t i = 0; i < attributes.size(); i++) {
+			header.attributes[i] = { attributes[i].location, (uint)attributes[i].format, attributes[i].offset };
+		}
+
+		header.indexType = mesh.indexType();
+		header.lodCount = (uint)mesh.lods().size();
+		header.vertexCount = mesh.vertexCount();
+		header.indexCount = mesh.indexCount();
+
+		size_t lodBytes = mesh.lods().size_bytes();
+		size_t vertexBytes = mesh.vertices().size_bytes();
+		size_t indexBytes = mesh.indexCount() * indexSize(mesh.indexType());
+		header.lodsOffset = alignOffset(sizeof(MeshFileHeader));
+		header.verticesOffset = alignOffset(header.lodsOffset + lodBytes);
+		header.indicesOffset = alignOffset(header.verticesOffset + vertexBytes);
+		header.fileSize = header.indicesOffset + indexBytes;
+
+		header.quantization = mesh.quantization();
+		header.aabb = mesh.aabb();
+		header.boundingSphere = mesh.boundingSphere();
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("couldnt open file from path '" + path.string() + "'");
+		}
+
+		static constexpr char sPadding[MeshFileHeader::alignment]{};
+		auto writeBlob = [&](uint64 offset, const void* data, size_t size) {
+			file.write(sPadding, (std::streamsize)(offset - (uint64)file.tellp()));
+			file.write(static_cast<const char*>(data), (std::streamsize)size);
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeBlob(header.lodsOffset, mesh.lods().data(), lodBytes);
+		writeBlob(header.verticesOffset, mesh.vertices().data(), vertexBytes);
+		writeBlob(header.indicesOffset, indexData, indexBytes);
+
+		if (!file) {
+			throw std::runtime_error("failed to write mesh file '" + path.string() + "'");
+		}
+	}
+
+	template void writeMeshFile(const std::filesystem::path&, const Mesh<PositionColorVertex>&);
+	template void writeMeshFile(const std::filesystem::path&, const Mesh<SpriteVertex>&);
+	template void writeMeshFile(const std::filesystem::path&, const Mesh<PackedPositionColorVertex>&);
+	template void writeMeshFile(const std::filesystem::path&, const Mesh<PackedSpriteVertex>&);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <Utils.h>
+#include "Vertex.h"
+#include "Bounds.h"
+#include "MeshSimplifier.h"
+
+namespace cp {
+	template <class VertexT>
+	class Mesh;
+
+	struct MeshFileAttribute {
+		uint location = 0;
+		uint format = 0; // VkFormat
+		uint offset = 0;
+	};
+
+	// Layout of a .cpmesh file, little endian:
+	//   MeshFileHeader | MeshLod[lodCount] | vertices | indices
+	// every blob starts on an alignment boundary so a mapped file is uploaded without parsing
+	struct MeshFileHeader {
+		static constexpr uint magicValue = 0x48534d43; // "CMSH"
+		static constexpr uint currentVersion = 1;
+		static constexpr uint maxAttributes = 4;
+		static constexpr uint64 alignment = 64;
+
+		uint magic = magicValue;
+		uint version = currentVersion;
+
+		// vertex layout the blob was written with, checked against the vertex type it's loaded as
+		uint vertexStride = 0;
+		uint attributeCount = 0;
+		MeshFileAttribute attributes[maxAttributes]{};
+
+		uint indexType = VK_INDEX_TYPE_UINT16;
+		uint lodCount = 0;
+		uint64 vertexCount = 0;
+		uint64 indexCount = 0;
+
+		// byte offsets from the start of the file
+		uint64 lodsOffset = 0;
+		uint64 verticesOffset = 0;
+		uint64 indicesOffset = 0;
+		uint64 fileSize = 0;
+
+		VertexQuantization quantization{};
+		AABB aabb{};
+		BoundingSphere boundingSphere{};
+	};
+
+	static_assert(std::is_trivially_copyable_v<MeshFileHeader>, "mesh file header is read straight from the mapping");
+	static_assert(sizeof(MeshFileHeader) == 176, "mesh file header layout changed, bump currentVersion");
+
+	// Memory mapped mesh file, the spans point into the mapping and live as long as the MeshFile.
+	// Only the header is validated, the blobs are never touched on the CPU before they are uploaded.
+	class MeshFile {
+	public:
+		// throws when the file isn't a mesh file of the current version or is truncated
+		explicit MeshFile(const std::filesystem::path& path);
+
+		const MeshFileHeader& header() const { return *mHeader; }
+
+		template <class VertexT>
+		bool hasLayout() const {
+			VkVertexInputBindingDescription binding = VertexT::bindingDescription();
+			AttributeDescriptions attributes = VertexT::attributeDescriptions();
+			if (binding.stride != mHeader->vertexStride || attributes.size() != mHeader->attributeCount) return false;
+
+			for (size_t i = 0; i < attributes.size(); i++) {
+				const MeshFileAttribute& stored = mHeader->attributes[i];
+				if (stored.location != attributes[i].location || stored.format != (uint)attributes[i].format || stored.offset != attributes[i].offset) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template <class VertexT>
+		std::span<const VertexT> vertices() const {
+			if (!hasLayout<VertexT>()) {
+				throw std::runtime_error("mesh file '" + mPath.string() + "' has a different vertex layout");
+			}
+			return { reinterpret_cast<const VertexT*>(mFile.data() + mHeader->verticesOffset), (size_t)mHeader->vertexCount };
+		}
+
+		// indices in the width of indexType()
+		const void* indexData() const { return mFile.data() + mHeader->indicesOffset; }
+		VkIndexType indexType() const { return (VkIndexType)mHeader->indexType; }
+		size_t indexCount() const { return (size_t)mHeader->indexCount; }
+		std::span<const MeshLod> lods() const;
+
+	private:
+		std::filesystem::path mPath;
+		MappedFile mFile;
+		const MeshFileHeader* mHeader = nullptr;
+	};
+
+	// writes the retained CPU data of the mesh with its bounds, LODs and quantization, throws when
+	// the mesh was created with MeshCpuData::Release
+	template <class VertexT>
+	void writeMeshFile(const std::filesystem::path& path, const Mesh<VertexT>& mesh);
+}
@@ -0,0 +1,239 @@
+#include "MeshOptimizer.h"
+
+namespace cp {
+	float averageCacheMissRatio(std::span<const uint> indices, size_t vertexCount, uint cacheSize) {
+		if (indices.size() < 3) return 0.f;
+
+		// FIFO, a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+		std::vector<uint> loadedAt(vertexCount, 0);
+		uint misses = 0;
+		for (uint index : indices) {
+			if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+				misses++;
+				loadedAt[index] = misses;
+			}
+		}
+		return (float)misses / (float)(indices.size() / 3);
+	}
+
+	// scoring from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+	static constexpr uint sForsythCacheSize = 32;
+
+	static float forsythVertexScore(int cachePosition, uint remainingTriangles) {
+		if (remainingTriangles == 0) return -1.f;
+
+		float score = 0.f;
+		if (cachePosition >= 0) {
+			// the last triangle's vertices get a fixed score so the next triangle doesn't just reuse its edge
+			if (cachePosition < 3) {
+				score = 0.75f;
+			}
+			else {
+				float scaler = 1.f / (sForsythCacheSize - 3);
+				score = std::pow(1.f - (cachePosition - 3) * scaler, 1.5f);
+			}
+		}
+
+		// vertices with few triangles left are finished early so they don't stay around as lone triangles
+		return score + 2.f * std::pow((float)remainingTriangles, -0.5f);
+	}
+
+	void optimizeVertexCache(std::span<uint> indices, size_t vertexCount) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) return;
+
+		// triangles of every vertex in one array, the first remaining[v] entries of a vertex are still unadded
+		std::vector<uint> remaining(vertexCount, 0);
+		for (uint index : indices) {
+			remaining[index]++;
+		}
+
+		std::vector<uint> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++) {
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+		}
+
+		std::vector<uint> adjacency(indices.size());
+		std::vector<uint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacency[fill[indices[i]]++] = (uint)(i / 3);
+		}
+
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) {
+			vertexScores[v] = forsythVertexScore(-1, remaining[v]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		}
+
+		std::vector<uint8_t> added(triangleCount, 0);
+		std::vector<uint> output;
+		output.reserve(indices.size());
+
+		// three extra slots hold the vertices pushed out by the newest triangle until they are rescored
+		std::vector<uint> cache;
+		std::vector<uint> nextCache;
+		cache.reserve(sForsythCacheSize + 3);
+		nextCache.reserve(sForsythCacheSize + 3);
+
+		size_t scanCursor = 0;
+		int bestTriangle = -1;
+
+		for (size_t emitted = 0; emitted < triangleCount; emitted++) {
+			if (bestTriangle < 0) {
+				// nothing connected to the cache, continue with the first unadded triangle
+				while (added[scanCursor]) scanCursor++;
+				bestTriangle = (int)scanCursor;
+			}
+
+			uint triangle = (uint)bestTriangle;
+			added[triangle] = 1;
+
+			uint corners[3] = { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] };
+			nextCache.clear();
+			for (uint corner : corners) {
+				output.push_back(corner);
+				if (std::find(nextCache.begin(), nextCache.end(), corner) == nextCache.end()) {
+					nextCache.push_back(corner);
+				}
+
+				// remove the triangle from the vertex's unadded list
+				uint* first = adjacency.data() + adjacencyOffsets[corner];
+				uint* last = first + remaining[corner];
+				std::iter_swap(std::find(first, last, triangle), last - 1);
+				remaining[corner]--;
+			}
+
+			for (uint vertex : cache) {
+				if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+					nextCache.push_back(vertex);
+				}
+			}
+			std::swap(cache, nextCache);
+
+			// rescore everything whose cache position changed, including the vertices that fell out
+			for (size_t i = 0; i < cache.size(); i++) {
+				uint vertex = cache[i];
+				float score = forsythVertexScore(i < sForsythCacheSize ? (int)i : -1, remaining[vertex]);
+				float delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+
+				for (uint j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex] + remaining[vertex]; j++) {
+					triangleScores[adjacency[j]] += delta;
+				}
+			}
+
+			// picked only once all deltas are in, a triangle sharing several cache vertices is compared with its final score
+			bestTriangle = -1;
+			float bestScore = -1.f;
+			for (uint vertex : cache) {
+				for (uint j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex] + remaining[vertex]; j++) {
+					uint adjacent = adjacency[j];
+					if (triangleScores[adjacent] > bestScore) {
+						bestScore = triangleScores[adjacent];
+						bestTriangle = (int)adjacent;
+					}
+				}
+			}
+
+			if (cache.size() > sForsythCacheSize) {
+				cache.resize(sForsythCacheSize);
+			}
+		}
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void optimizeOverdraw(std::span<uint> indices, std::span<const glm::vec3> positions, uint cacheSize) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) return;
+
+		// a cluster starts where all three vertices miss, reordering whole clusters keeps their cache hits
+		std::vector<size_t> clusterStarts;
+		std::vector<uint> loadedAt(positions.size(), 0);
+		uint misses = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			uint triangleMisses = 0;
+			for (uint c = 0; c < 3; c++) {
+				uint index = indices[t * 3 + c];
+				if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+					misses++;
+					loadedAt[index] = misses;
+					triangleMisses++;
+				}
+			}
+			if (t == 0 || triangleMisses == 3) {
+				clusterStarts.push_back(t);
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+
+		glm::vec3 meshCenter{0.f};
+		for (uint index : indices) {
+			meshCenter += positions[index];
+		}
+		meshCenter /= (float)indices.size();
+
+		// clusters facing away from the center are drawn first, they are likely to occlude the rest
+		struct Cluster {
+			size_t first;
+			size_t last;
+			float sortKey;
+		};
+
+		std::vector<Cluster> clusters;
+		clusters.reserve(clusterStarts.size() - 1);
+		for (size_t c = 0; c + 1 < clusterStarts.size(); c++) {
+			glm::vec3 centroid{0.f};
+			glm::vec3 normal{0.f};
+			float area = 0.f;
+
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+				glm::vec3 p0 = positions[indices[t * 3]];
+				glm::vec3 p1 = positions[indices[t * 3 + 1]];
+				glm::vec3 p2 = positions[indices[t * 3 + 2]];
+
+				// area weighted, the cross product length is twice the triangle area
+				glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+				float triangleArea = glm::length(cross);
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+				normal += cross;
+				area += triangleArea;
+			}
+
+			float normalLength = glm::length(normal);
+			float sortKey = 0.f;
+			if (area > 0.f && normalLength > 0.f) {
+				sortKey = glm::dot(centroid / area - meshCenter, normal / normalLength);
+			}
+			clusters.push_back({ clusterStarts[c], clusterStarts[c + 1], sortKey });
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+			return a.sortKey > b.sortKey;
+		});
+
+		std::vector<uint> sorted;
+		sorted.reserve(indices.size());
+		for (const Cluster& cluster : clusters) {
+			sorted.insert(sorted.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+		}
+		std::copy(sorted.begin(), sorted.end(), indices.begin());
+	}
+
+	std::vector<uint> optimizeVertexFetchRemap(std::span<uint> indices, size_t vertexCount, size_t& usedVertexCount) {
+		std::vector<uint> remap(vertexCount, invalidVertex);
+		uint next = 0;
+		for (uint& index : indices) {
+			if (remap[index] == invalidVertex) {
+				remap[index] = next++;
+			}
+			index = remap[index];
+		}
+		usedVertexCount = next;
+		return remap;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Vertex.h"
+
+namespace cp {
+	// average cache miss ratio, transformed vertices per triangle with a FIFO post-transform cache,
+	// 0.5 is the optimum for large regular meshes and 3 the worst case
+	float averageCacheMissRatio(std::span<const uint> indices, size_t vertexCount, uint cacheSize = 16);
+
+	// reorders triangles with Forsyth's linear speed vertex cache optimization, independent of the cache size
+	void optimizeVertexCache(std::span<uint> indices, size_t vertexCount);
+
+	// Sorts clusters of the cache optimized triangle order so that outward facing ones come first and
+	// hide what is behind them. Clusters are split only where the cache starts over, which keeps the ACMR.
+	void optimizeOverdraw(std::span<uint> indices, std::span<const glm::vec3> positions, uint cacheSize = 16);
+
+	// renumbers vertices in order of first use and rewrites the indices, returns the new index of every
+	// vertex (invalidVertex for unreferenced ones) and the number of referenced vertices
+	constexpr uint invalidVertex = (uint)(-1);
+	std::vector<uint> optimizeVertexFetchRemap(std::span<uint> indices, size_t vertexCount, size_t& usedVertexCount);
+
+	struct MeshOptimizerSettings {
+		bool vertexCache = true;
+		bool overdraw = true;
+		bool vertexFetch = true;
+		// FIFO size used for the reported ACMR and the overdraw clusters
+		uint cacheSize = 16;
+	};
+
+	struct MeshOptimizationReport {
+		float acmrBefore = 0.f;
+		float acmrAfter = 0.f;
+		size_t unusedVerticesRemoved = 0;
+	};
+
+	// runs the enabled passes in the order they depend on each other, unreferenced vertices are dropped
+	template <class VertexT>
+	MeshOptimizationReport optimizeMesh(std::vector<VertexT>& vertices, std::vector<uint>& indices, const MeshOptimizerSettings& settings = {}) {
+		MeshOptimizationReport report{};
+		report.acmrBefore = averageCacheMissRatio(indices, vertices.size(), settings.cacheSize);
+
+		if (settings.vertexCache) {
+			optimizeVertexCache(indices, vertices.size());
+		}
+
+		if (settings.overdraw) {
+			// packed layouts are sorted in packed space, the quantization doesn't change the order
+			std::vector<glm::vec3> positions = vertexPositions(std::span<const VertexT>(vertices));
+			optimizeOverdraw(indices, positions, settings.cacheSize);
+		}
+
+		if (settings.vertexFetch) {
+			size_t usedVertexCount = 0;
+			std::vector<uint> remap = optimizeVertexFetchRemap(indices, vertices.size(), usedVertexCount);
+
+			std::vector<VertexT> remapped(usedVertexCount);
+			for (size_t i = 0; i < vertices.size(); i++) {
+				if (remap[i] != invalidVertex) {
+					remapped[remap[i]] = vertices[i];
+				}
+			}
+			report.unusedVerticesRemoved = vertices.size() - usedVertexCount;
+			vertices = std::move(remapped);
+		}
+
+		report.acmrAfter = averageCacheMissRatio(indices, vertices.size(), settings.cacheSize);
+		return report;
+	}
+}
@@ -0,0 +1,303 @@
+#include "MeshSimplifier.h"
+
+namespace cp {
+	// symmetric 4x4 matrix of plane equations, error(p) = p^T Q p with p = (x, y, z, 1)
+	struct Quadric {
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+		// summed triangle areas, errors are divided by it to get back to squared distances
+		double weight = 0;
+
+		static Quadric fromPlane(const glm::dvec3& normal, double d, double weight) {
+			Quadric q;
+			q.a2 = normal.x * normal.x * weight; q.ab = normal.x * normal.y * weight; q.ac = normal.x * normal.z * weight; q.ad = normal.x * d * weight;
+			q.b2 = normal.y * normal.y * weight; q.bc = normal.y * normal.z * weight; q.bd = normal.y * d * weight;
+			q.c2 = normal.z * normal.z * weight; q.cd = normal.z * d * weight;
+			q.d2 = d * d * weight;
+			q.weight = weight;
+			return q;
+		}
+
+		void add(const Quadric& other) {
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+		}
+
+		double error(const glm::dvec3& p) const {
+			double result =
+				a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+				b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y +
+				c2 * p.z * p.z + 2 * cd * p.z +
+				d2;
+			return std::max(result, 0.0) / (weight > 0 ? weight : 1.0);
+		}
+	};
+
+	// boundary planes count this much more than the triangle planes around them
+	static constexpr double sBoundaryWeight = 10.0;
+
+	static glm::dvec3 toDouble(const glm::vec3& v) {
+		return { v.x, v.y, v.z };
+	}
+
+	// vertices sharing a position with another vertex split attributes, moving one of them would open the seam
+	static std::vector<uint8_t> findSeamVertices(std::span<const glm::vec3> positions) {
+		struct PositionHash {
+			size_t operator()(const glm::vec3& p) const {
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		std::unordered_map<glm::vec3, uint, PositionHash> counts;
+		counts.reserve(positions.size());
+		for (const glm::vec3& position : positions) {
+			counts[position]++;
+		}
+
+		std::vector<uint8_t> seam(positions.size());
+		for (size_t v = 0; v < positions.size(); v++) {
+			seam[v] = counts[positions[v]] > 1;
+		}
+		return seam;
+	}
+
+	static std::vector<Quadric> computeQuadrics(std::span<const uint> indices, std::span<const glm::vec3> positions) {
+		std::vector<Quadric> quadrics(positions.size());
+
+		// edges used by a single triangle, keyed by their ordered vertex pair
+		std::unordered_map<uint64, uint> edgeUses;
+		edgeUses.reserve(indices.size());
+
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			glm::dvec3 p0 = toDouble(positions[indices[t]]);
+			glm::dvec3 p1 = toDouble(positions[indices[t + 1]]);
+			glm::dvec3 p2 = toDouble(positions[indices[t + 2]]);
+
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			double length = glm::length(normal);
+			if (length > 0) {
+				normal /= length;
+				Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), length * 0.5);
+				for (uint c = 0; c < 3; c++) {
+					quadrics[indices[t + c]].add(plane);
+				}
+			}
+
+			for (uint c = 0; c < 3; c++) {
+				uint a = indices[t + c];
+				uint b = indices[t + (c + 1) % 3];
+				edgeUses[((uint64)std::min(a, b) << 32) | std::max(a, b)]++;
+			}
+		}
+
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			glm::dvec3 p0 = toDouble(positions[indices[t]]);
+			glm::dvec3 p1 = toDouble(positions[indices[t + 1]]);
+			glm::dvec3 p2 = toDouble(positions[indices[t + 2]]);
+			glm::dvec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+
+			for (uint c = 0; c < 3; c++) {
+				uint a = indices[t + c];
+				uint b = indices[t + (c + 1) % 3];
+				if (edgeUses[((uint64)std::min(a, b) << 32) | std::max(a, b)] != 1) continue;
+
+				// plane through the edge perpendicular to the face, collapses pulling the border inwards get expensive
+				glm::dvec3 pa = toDouble(positions[a]);
+				glm::dvec3 edge = toDouble(positions[b]) - pa;
+				glm::dvec3 normal = glm::cross(edge, faceNormal);
+				double length = glm::length(normal);
+				if (length == 0) continue;
+
+				normal /= length;
+				Quadric border = Quadric::fromPlane(normal, -glm::dot(normal, pa), glm::dot(edge, edge) * sBoundaryWeight);
+				border.weight = 0;
+				quadrics[a].add(border);
+				quadrics[b].add(border);
+			}
+		}
+		return quadrics;
+	}
+
+	// moving from onto to must not turn any remaining triangle of from around, corners already collapsed
+	// in this pass are looked up through remap
+	static bool collapseFlips(
+		uint from,
+		uint to,
+		std::span<const uint> indices,
+		const std::vector<uint>& remap,
+		std::span<const glm::vec3> positions,
+		const std::vector<uint>& triangleOffsets,
+		const std::vector<uint>& triangles
+	) {
+		for (uint i = triangleOffsets[from]; i < triangleOffsets[from + 1]; i++) {
+			uint t = triangles[i] * 3;
+			uint corners[3] = { remap[indices[t]], remap[indices[t + 1]], remap[indices[t + 2]] };
+			if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) continue;
+			if (corners[0] == to || corners[1] == to || corners[2] == to) continue;
+
+			glm::vec3 before = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+			for (uint& corner : corners) {
+				if (corner == from) corner = to;
+			}
+			glm::vec3 after = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+
+			if (glm::dot(before, after) <= 0.f) return true;
+		}
+		return false;
+	}
+
+	std::vector<uint> simplifyMesh(
+		std::span<const uint> indices,
+		std::span<const glm::vec3> positions,
+		size_t targetIndexCount,
+		float targetError,
+		float& resultError
+	) {
+		resultError = 0.f;
+		std::vector<uint> result(indices.begin(), indices.end());
+		if (result.size() <= targetIndexCount || positions.empty()) return result;
+
+		glm::vec3 min = positions[0];
+		glm::vec3 max = positions[0];
+		for (const glm::vec3& position : positions) {
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+		glm::vec3 size = max - min;
+		double extent = std::max({ size.x, size.y, size.z });
+		double maxCost = (targetError * extent) * (targetError * extent);
+
+		std::vector<Quadric> quadrics = computeQuadrics(indices, positions);
+		std::vector<uint8_t> seam = findSeamVertices(positions);
+		std::vector<uint> remap(positions.size());
+		double largestCost = 0;
+
+		struct Collapse {
+			uint from;
+			uint to;
+			double cost;
+		};
+
+		std::vector<Collapse> collapses;
+		std::vector<uint64> edges;
+		std::vector<uint> triangleOffsets(positions.size() + 1);
+		std::vector<uint> triangles;
+		std::vector<uint8_t> touched(positions.size());
+
+		// every pass collapses a set of independent edges, cheapest first, then rebuilds the adjacency
+		while (result.size() > targetIndexCount) {
+			edges.clear();
+			for (size_t t = 0; t < result.size(); t += 3) {
+				for (uint c = 0; c < 3; c++) {
+					uint a = result[t + c];
+					uint b = result[t + (c + 1) % 3];
+					edges.push_back(((uint64)std::min(a, b) << 32) | std::max(a, b));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+			collapses.clear();
+			for (uint64 edge : edges) {
+				uint a = (uint)(edge >> 32);
+				uint b = (uint)edge;
+
+				Quadric merged = quadrics[a];
+				merged.add(quadrics[b]);
+
+				// the cheaper direction that doesn't move a seam vertex
+				double costToB = seam[a] ? std::numeric_limits<double>::max() : merged.error(toDouble(positions[b]));
+				double costToA = seam[b] ? std::numeric_limits<double>::max() : merged.error(toDouble(positions[a]));
+				Collapse collapse = costToB <= costToA ? Collapse{ a, b, costToB } : Collapse{ b, a, costToA };
+				if (collapse.cost <= maxCost) {
+					collapses.push_back(collapse);
+				}
+			}
+			if (collapses.empty()) break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (uint index : result) {
+				triangleOffsets[index + 1]++;
+			}
+			for (size_t v = 0; v < positions.size(); v++) {
+				triangleOffsets[v + 1] += triangleOffsets[v];
+			}
+			triangles.resize(result.size());
+			std::vector<uint> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++) {
+				triangles[fill[result[i]]++] = (uint)(i / 3);
+			}
+
+			for (size_t v = 0; v < positions.size(); v++) {
+				remap[v] = (uint)v;
+			}
+			std::fill(touched.begin(), touched.end(), 0);
+
+			// a collapse removes about two triangles, stop near the target instead of overshooting it
+			size_t collapseBudget = std::max<size_t>((result.size() - targetIndexCount) / 6, 1);
+			size_t performed = 0;
+
+			for (const Collapse& collapse : collapses) {
+				if (performed >= collapseBudget) break;
+				if (touched[collapse.from] || touched[collapse.to]) continue;
+				if (collapseFlips(collapse.from, collapse.to, result, remap, positions, triangleOffsets, triangles)) continue;
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				touched[collapse.from] = 1;
+				touched[collapse.to] = 1;
+				largestCost = std::max(largestCost, collapse.cost);
+				performed++;
+			}
+			if (performed == 0) break;
+
+			size_t write = 0;
+			for (size_t t = 0; t < result.size(); t += 3) {
+				uint a = remap[result[t]];
+				uint b = remap[result[t + 1]];
+				uint c = remap[result[t + 2]];
+				if (a == b || b == c || a == c) continue;
+
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+		}
+
+		resultError = (float)std::sqrt(largestCost);
+		return result;
+	}
+
+	LodChain generateLodChain(std::span<const uint> indices, std::span<const glm::vec3> positions, const LodChainSettings& settings) {
+		LodChain chain;
+		chain.indices.assign(indices.begin(), indices.end());
+		chain.lods.push_back({ 0, (uint)indices.size(), 0.f });
+
+		// levels are simplified from the full mesh, their errors don't accumulate
+		size_t targetIndexCount = indices.size();
+		for (uint level = 1; level <= settings.maxLods; level++) {
+			targetIndexCount = (size_t)(targetIndexCount * settings.reduction) / 3 * 3;
+			if (targetIndexCount < settings.minTriangles * 3) break;
+
+			float error = 0.f;
+			std::vector<uint> lod = simplifyMesh(indices, positions, targetIndexCount, settings.maxError, error);
+
+			// the error bound was hit before the level got meaningfully smaller
+			if (lod.size() > chain.lods.back().indexCount * 0.9f) break;
+
+			chain.lods.push_back({ (uint)chain.indices.size(), (uint)lod.size(), error });
+			chain.indices.insert(chain.indices.end(), lod.begin(), lod.end());
+		}
+		return chain;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "Vertex.h"
+
+namespace cp {
+	// Quadric error metric edge collapse (Garland and Heckbert). Vertices are only ever merged into other
+	// vertices, never moved, so every simplified index list still refers to the original vertex buffer.
+	// Boundary edges are held in place by perpendicular planes and vertices sharing their position with
+	// another vertex (attribute seams) are never moved. Stops at targetIndexCount or when the next collapse
+	// would exceed targetError, a distance relative to the largest extent of the mesh. resultError receives
+	// the largest error of the performed collapses in mesh space units.
+	std::vector<uint> simplifyMesh(
+		std::span<const uint> indices,
+		std::span<const glm::vec3> positions,
+		size_t targetIndexCount,
+		float targetError,
+		float& resultError
+	);
+
+	// range of the index buffer drawing one level, error is the mesh space deviation from level 0
+	struct MeshLod {
+		uint firstIndex = 0;
+		uint indexCount = 0;
+		float error = 0.f;
+	};
+
+	struct LodChainSettings {
+		// levels after the full detail one
+		uint maxLods = 4;
+		// index count of every level relative to the previous one
+		float reduction = 0.5f;
+		// relative to the largest mesh extent, levels that can't get smaller within it end the chain
+		float maxError = 0.05f;
+		size_t minTriangles = 16;
+	};
+
+	// every level concatenated into one index list, level 0 is the input
+	struct LodChain {
+		std::vector<uint> indices;
+		std::vector<MeshLod> lods;
+	};
+
+	LodChain generateLodChain(std::span<const uint> indices, std::span<const glm::vec3> positions, const LodChainSettings& settings = {});
+}
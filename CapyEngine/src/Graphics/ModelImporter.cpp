@@ -0,0 +1,918 @@
+#include "ModelImporter.h"
+#include "MeshOptimizer.h"
+#include <Vulkan/ResourceManager.h>
+#include <charconv>
+
+namespace cp {
+	using Clock = std::chrono::steady_clock;
+
+	static float elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	// every task finishes before an exception is rethrown, they reference the caller's locals
+	template<class T>
+	static std::vector<T> collectResults(std::vector<std::future<T>>& futures) {
+		for (auto& future : futures) {
+			future.wait();
+		}
+
+		std::vector<T> results;
+		results.reserve(futures.size());
+		for (auto& future : futures) {
+			results.push_back(future.get());
+		}
+		return results;
+	}
+
+	ModelImporter::ModelImporter(const ModelImportSettings& settings)
+		: mSettings(settings), mPool(settings.threads > 0 ? settings.threads : std::max(std::thread::hardware_concurrency(), 1u)) {}
+
+	std::vector<ModelMeshData> ModelImporter::load(const std::filesystem::path& path) {
+		Clock::time_point start = Clock::now();
+		mStats = {};
+
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+
+		std::vector<ModelMeshData> meshes;
+		if (extension == ".obj") {
+			meshes = loadObj(path);
+		}
+		else if (extension == ".gltf" || extension == ".glb") {
+			meshes = loadGltf(path);
+		}
+		else {
+			throw std::runtime_error("unsupported model format '" + path.string() + "'");
+		}
+
+		finishMeshes(meshes);
+
+		mStats.meshes = meshes.size();
+		for (const ModelMeshData& mesh : meshes) {
+			mStats.vertices += mesh.positions.size();
+			mStats.triangles += (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3;
+		}
+		mStats.parseMs = elapsedMs(start);
+		return meshes;
+	}
+
+	static void fillVertex(PositionColorVertex& vertex, const ModelMeshData& mesh, size_t i) {
+		vertex.position = mesh.positions[i];
+		vertex.color = mesh.colors[i];
+	}
+
+	static void fillVertex(SpriteVertex& vertex, const ModelMeshData& mesh, size_t i) {
+		vertex.position = mesh.positions[i];
+		vertex.color = mesh.colors[i];
+		vertex.texCoord = mesh.texCoords[i];
+	}
+
+	template<class VertexT>
+	std::vector<ImportedMesh<VertexT>> ModelImporter::import(const std::filesystem::path& path) {
+		std::vector<ModelMeshData> meshes = load(path);
+		Clock::time_point start = Clock::now();
+
+		std::vector<ImportedMesh<VertexT>> imported;
+		imported.reserve(meshes.size());
+		for (ModelMeshData& data : meshes) {
+			std::vector<VertexT> vertices(data.positions.size());
+			for (size_t i = 0; i < vertices.size(); i++) {
+				fillVertex(vertices[i], data, i);
+			}
+
+			ImportedMesh<VertexT>& mesh = imported.emplace_back();
+			mesh.name = std::move(data.name);
+			if (data.lods.empty()) {
+				mesh.mesh = std::make_unique<Mesh<VertexT>>(std::move(vertices), std::move(data.indices), mSettings.cpuData);
+			}
+			else {
+				LodChain lodChain{ std::move(data.indices), std::move(data.lods) };
+				mesh.mesh = std::make_unique<Mesh<VertexT>>(std::span<const VertexT>(vertices), lodChain, mSettings.cpuData);
+			}
+			data = {};
+		}
+
+		// the uploads were only queued while creating the meshes
+		ResourceManager::flushUploads();
+		mStats.uploadMs = elapsedMs(start);
+		return imported;
+	}
+
+	template std::vector<ImportedMesh<PositionColorVertex>> ModelImporter::import(const std::filesystem::path&);
+	template std::vector<ImportedMesh<SpriteVertex>> ModelImporter::import(const std::filesystem::path&);
+
+	template<class T>
+	static void remapAttribute(std::vector<T>& attribute, const std::vector<uint>& remap, size_t usedCount) {
+		std::vector<T> remapped(usedCount);
+		for (size_t i = 0; i < attribute.size(); i++) {
+			if (remap[i] != invalidVertex) {
+				remapped[remap[i]] = attribute[i];
+			}
+		}
+		attribute = std::move(remapped);
+	}
+
+	void ModelImporter::finishMeshes(std::vector<ModelMeshData>& meshes) {
+		if (!mSettings.optimize && !mSettings.generateLods) return;
+
+		std::vector<std::future<void>> tasks;
+		tasks.reserve(meshes.size());
+		for (ModelMeshData& mesh : meshes) {
+			tasks.push_back(mPool.submit([this, &mesh]() {
+				if (mSettings.optimize) {
+					optimizeVertexCache(mesh.indices, mesh.positions.size());
+					optimizeOverdraw(mesh.indices, mesh.positions);
+
+					size_t usedCount = 0;
+					std::vector<uint> remap = optimizeVertexFetchRemap(mesh.indices, mesh.positions.size(), usedCount);
+					remapAttribute(mesh.positions, remap, usedCount);
+					remapAttribute(mesh.colors, remap, usedCount);
+					remapAttribute(mesh.texCoords, remap, usedCount);
+				}
+
+				if (mSettings.generateLods) {
+					LodChain lodChain = generateLodChain(mesh.indices, mesh.positions, mSettings.lodSettings);
+					if (mSettings.optimize) {
+						for (size_t lod = 1; lod < lodChain.lods.size(); lod++) {
+							std::span<uint> level(lodChain.indices.data() + lodChain.lods[lod].firstIndex, lodChain.lods[lod].indexCount);
+							optimizeVertexCache(level, mesh.positions.size());
+						}
+					}
+					mesh.indices = std::move(lodChain.indices);
+					mesh.lods = std::move(lodChain.lods);
+				}
+			}));
+		}
+		for (auto& task : tasks) {
+			task.wait();
+		}
+		for (auto& task : tasks) {
+			task.get();
+		}
+	}
+
+	// OBJ
+
+	// indices are absolute or, when negative in the file, relative to the chunk's first element until the chunks are merged
+	struct ObjCorner {
+		int64 position = 0;
+		int64 texCoord = 0;
+		uint8_t flags = 0;
+
+		static constexpr uint8_t positionRelative = 1;
+		static constexpr uint8_t texCoordRelative = 2;
+		static constexpr uint8_t hasTexCoord = 4;
+	};
+
+	struct ObjGroup {
+		std::string name;
+		size_t firstCorner = 0;
+	};
+
+	struct ObjChunk {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec4> colors;
+		std::vector<glm::vec2> texCoords;
+		std::vector<ObjCorner> corners;
+		std::vector<ObjGroup> groups;
+	};
+
+	static bool isObjSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	struct ObjLine {
+		const char* cursor;
+		const char* end;
+
+		std::string_view token() {
+			while (cursor < end && isObjSpace(*cursor)) cursor++;
+			const char* first = cursor;
+			while (cursor < end && !isObjSpace(*cursor)) cursor++;
+			return { first, (size_t)(cursor - first) };
+		}
+
+		std::string_view rest() {
+			while (cursor < end && isObjSpace(*cursor)) cursor++;
+			const char* last = end;
+			while (last > cursor && isObjSpace(last[-1])) last--;
+			return { cursor, (size_t)(last - cursor) };
+		}
+
+		// reads up to maxCount floats, returns how many there were
+		uint floats(float* values, uint maxCount) {
+			uint count = 0;
+			while (count < maxCount) {
+				std::string_view number = token();
+				if (number.empty()) break;
+				if (std::from_chars(number.data(), number.data() + number.size(), values[count]).ec != std::errc()) break;
+				count++;
+			}
+			return count;
+		}
+	};
+
+	static ObjChunk parseObjChunk(const char* begin, const char* end) {
+		ObjChunk chunk;
+
+		// corners of the current face, triangulated as a fan
+		std::vector<ObjCorner> face;
+
+		auto resolve = [](int64 index, int64 count, int64& resolved) {
+			if (index > 0) {
+				resolved = index - 1;
+				return false;
+			}
+			if (index == 0) throw std::runtime_error("OBJ index 0 is invalid");
+			resolved = count + index;
+			return true;
+		};
+
+		for (const char* line = begin; line < end;) {
+			const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+			if (!lineEnd) lineEnd = end;
+
+			ObjLine scanner{ line, lineEnd };
+			std::string_view keyword = scanner.token();
+
+			if (keyword == "v") {
+				// x y z, optionally followed by w or by the r g b extension
+				float values[7];
+				uint count = scanner.floats(values, 7);
+				if (count < 3) throw std::runtime_error("OBJ vertex with less than 3 coordinates");
+
+				chunk.positions.push_back({ values[0], values[1], values[2] });
+				if (count >= 6) {
+					uint first = count == 7 ? 4 : 3;
+					chunk.colors.push_back({ values[first], values[first + 1], values[first + 2], 1.f });
+				}
+				else {
+					chunk.colors.push_back(glm::vec4(1.f));
+				}
+			}
+			else if (keyword == "vt") {
+				float values[3] = { 0.f, 0.f, 0.f };
+				scanner.floats(values, 3);
+				chunk.texCoords.push_back({ values[0], 1.f - values[1] });
+			}
+			else if (keyword == "f") {
+				face.clear();
+				for (std::string_view vertex = scanner.token(); !vertex.empty(); vertex = scanner.token()) {
+					const char* cursor = vertex.data();
+					const char* vertexEnd = vertex.data() + vertex.size();
+
+					int64 position = 0;
+					auto result = std::from_chars(cursor, vertexEnd, position);
+					if (result.ec != std::errc()) throw std::runtime_error("malformed OBJ face");
+					cursor = result.ptr;
+
+					ObjCorner corner{};
+					if (resolve(position, (int64)chunk.positions.size(), corner.position)) {
+						corner.flags |= ObjCorner::positionRelative;
+					}
+
+					// v/vt, v//vn and v/vt/vn, normals are not used by the vertex layouts
+					if (cursor < vertexEnd && *cursor == '/' && cursor + 1 < vertexEnd && cursor[1] != '/') {
+						int64 texCoord = 0;
+						if (std::from_chars(cursor + 1, vertexEnd, texCoord).ec != std::errc()) throw std::runtime_error("malformed OBJ face");
+
+						corner.flags |= ObjCorner::hasTexCoord;
+						if (resolve(texCoord, (int64)chunk.texCoords.size(), corner.texCoord)) {
+							corner.flags |= ObjCorner::texCoordRelative;
+						}
+					}
+					face.push_back(corner);
+				}
+
+				for (size_t i = 2; i < face.size(); i++) {
+					chunk.corners.push_back(face[0]);
+					chunk.corners.push_back(face[i - 1]);
+					chunk.corners.push_back(face[i]);
+				}
+			}
+			else if (keyword == "o" || keyword == "g") {
+				chunk.groups.push_back({ std::string(scanner.rest()), chunk.corners.size() });
+			}
+
+			line = lineEnd + 1;
+		}
+		return chunk;
+	}
+
+	// vertices are shared by corners with the same position and texture coordinate
+	static ModelMeshData buildObjMesh(
+		std::string name,
+		std::span<const ObjCorner> corners,
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec4>& colors,
+		const std::vector<glm::vec2>& texCoords
+	) {
+		ModelMeshData mesh;
+		mesh.name = std::move(name);
+		mesh.indices.reserve(corners.size());
+
+		std::unordered_map<uint64, uint> vertices;
+		vertices.reserve(corners.size() / 2);
+
+		for (const ObjCorner& corner : corners) {
+			bool textured = corner.flags & ObjCorner::hasTexCoord;
+			uint64 key = ((uint64)corner.position << 32) | (textured ? (uint64)corner.texCoord + 1 : 0);
+
+			auto [it, inserted] = vertices.try_emplace(key, (uint)mesh.positions.size());
+			if (inserted) {
+				mesh.positions.push_back(positions[corner.position]);
+				mesh.colors.push_back(colors[corner.position]);
+				mesh.texCoords.push_back(textured ? texCoords[corner.texCoord] : glm::vec2(0.f));
+			}
+			mesh.indices.push_back(it->second);
+		}
+		return mesh;
+	}
+
+	std::vector<ModelMeshData> ModelImporter::loadObj(const std::filesystem::path& path) {
+		MappedFile file(path);
+		const char* data = reinterpret_cast<const char*>(file.data());
+		const char* end = data + file.size();
+
+		// chunks end after a newline so no line is split between two of them
+		std::vector<const char*> chunkStarts{ data };
+		size_t chunkSize = std::max<size_t>(mSettings.chunkSize, 1);
+		while ((size_t)(end - chunkStarts.back()) > chunkSize) {
+			const char* searchStart = chunkStarts.back() + chunkSize;
+			const char* newline = static_cast<const char*>(memchr(searchStart, '\n', end - searchStart));
+			if (!newline || newline + 1 == end) break;
+			chunkStarts.push_back(newline + 1);
+		}
+		chunkStarts.push_back(end);
+
+		std::vector<std::future<ObjChunk>> parsed;
+		for (size_t i = 0; i + 1 < chunkStarts.size(); i++) {
+			const char* first = chunkStarts[i];
+			const char* last = chunkStarts[i + 1];
+			parsed.push_back(mPool.submit([first, last]() { return parseObjChunk(first, last); }));
+		}
+
+		std::vector<ObjChunk> chunks = collectResults(parsed);
+
+		// relative indices become absolute once the elements before each chunk are known
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec4> colors;
+		std::vector<glm::vec2> texCoords;
+		std::vector<ObjCorner> corners;
+		std::vector<ObjGroup> groups;
+
+		for (ObjChunk& chunk : chunks) {
+			int64 positionBase = (int64)positions.size();
+			int64 texCoordBase = (int64)texCoords.size();
+			size_t cornerBase = corners.size();
+
+			for (ObjCorner& corner : chunk.corners) {
+				if (corner.flags & ObjCorner::positionRelative) corner.position += positionBase;
+				if (corner.flags & ObjCorner::texCoordRelative) corner.texCoord += texCoordBase;
+			}
+			for (ObjGroup& group : chunk.groups) {
+				group.firstCorner += cornerBase;
+				groups.push_back(std::move(group));
+			}
+
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+			texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+			corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+			chunk = {};
+		}
+
+		for (const ObjCorner& corner : corners) {
+			bool validPosition = corner.position >= 0 && corner.position < (int64)positions.size();
+			bool validTexCoord = !(corner.flags & ObjCorner::hasTexCoord) || (corner.texCoord >= 0 && corner.texCoord < (int64)texCoords.size());
+			if (!validPosition || !validTexCoord) {
+				throw std::runtime_error("OBJ face index out of range in '" + path.string() + "'");
+			}
+		}
+
+		// faces before the first group belong to a mesh named after the file
+		groups.insert(groups.begin(), { path.stem().string(), 0 });
+
+		std::vector<std::future<ModelMeshData>> built;
+		for (size_t i = 0; i < groups.size(); i++) {
+			size_t first = groups[i].firstCorner;
+			size_t last = i + 1 < groups.size() ? groups[i + 1].firstCorner : corners.size();
+			if (first == last) continue;
+
+			std::span<const ObjCorner> groupCorners(corners.data() + first, last - first);
+			built.push_back(mPool.submit([&, groupCorners, name = groups[i].name]() {
+				return buildObjMesh(name, groupCorners, positions, colors, texCoords);
+			}));
+		}
+
+		return collectResults(built);
+	}
+
+	// glTF
+
+	struct JsonValue {
+		enum class Type { Null, Bool, Number, String, Array, Object };
+
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> array;
+		std::vector<std::pair<std::string, JsonValue>> members;
+
+		// missing keys and indices give a null value so lookups can be chained
+		const JsonValue& operator[](std::string_view key) const {
+			for (const auto& [name, value] : members) {
+				if (name == key) return value;
+			}
+			return null();
+		}
+		const JsonValue& operator[](size_t index) const { return index < array.size() ? array[index] : null(); }
+
+		bool has(std::string_view key) const { return (*this)[key].type != Type::Null; }
+		// references to other elements, out of range of every array when missing or not an index
+		size_t index() const { return integral() ? (size_t)number : (size_t)(-1); }
+		// counts, offsets and enums, anything but a non-negative integer would wrap on the cast
+		size_t integerOr(size_t fallback) const {
+			if (type == Type::Null) return fallback;
+			if (!integral()) throw std::runtime_error("malformed glTF, expected a non-negative integer");
+			return (size_t)number;
+		}
+		// exactly representable, larger values can't be valid sizes of a mapped file either
+		bool integral() const { return type == Type::Number && number >= 0.0 && number <= 9007199254740992.0 && number == std::floor(number); }
+		size_t size() const { return array.size(); }
+
+		static const JsonValue& null() {
+			static const JsonValue sNull{};
+			return sNull;
+		}
+	};
+
+	class JsonParser {
+	public:
+		explicit JsonParser(std::string_view text) : mText(text) {}
+
+		JsonValue parse() {
+			JsonValue value = parseValue(0);
+			skipWhitespace();
+			if (mPos != mText.size()) fail("trailing characters");
+			return value;
+		}
+
+	private:
+		[[noreturn]] void fail(const char* reason) {
+			throw std::runtime_error("invalid glTF JSON at offset " + std::to_string(mPos) + ": " + reason);
+		}
+
+		void skipWhitespace() {
+			while (mPos < mText.size() && (mText[mPos] == ' ' || mText[mPos] == '\t' || mText[mPos] == '\n' || mText[mPos] == '\r')) mPos++;
+		}
+
+		bool consume(std::string_view literal) {
+			if (mText.substr(mPos, literal.size()) != literal) return false;
+			mPos += literal.size();
+			return true;
+		}
+
+		JsonValue parseValue(uint depth) {
+			// glTF nests a few levels deep, anything deeper is malformed and would only grow the stack
+			if (depth > 64) fail("nested too deep");
+
+			skipWhitespace();
+			if (mPos >= mText.size()) fail("unexpected end");
+
+			JsonValue value;
+			char c = mText[mPos];
+			if (c == '{') {
+				value.type = JsonValue::Type::Object;
+				mPos++;
+				skipWhitespace();
+				if (consume("}")) return value;
+				do {
+					skipWhitespace();
+					if (mPos >= mText.size() || mText[mPos] != '"') fail("expected a key");
+					std::string key = parseString();
+					skipWhitespace();
+					if (!consume(":")) fail("expected ':'");
+					value.members.emplace_back(std::move(key), parseValue(depth + 1));
+					skipWhitespace();
+				} while (consume(","));
+				if (!consume("}")) fail("expected '}'");
+			}
+			else if (c == '[') {
+				value.type = JsonValue::Type::Array;
+				mPos++;
+				skipWhitespace();
+				if (consume("]")) return value;
+				do {
+					value.array.push_back(parseValue(depth + 1));
+					skipWhitespace();
+				} while (consume(","));
+				if (!consume("]")) fail("expected ']'");
+			}
+			else if (c == '"') {
+				value.type = JsonValue::Type::String;
+				value.string = parseString();
+			}
+			else if (consume("true")) {
+				value.type = JsonValue::Type::Bool;
+				value.boolean = true;
+			}
+			else if (consume("false")) {
+				value.type = JsonValue::Type::Bool;
+			}
+			else if (consume("null")) {
+			}
+			else {
+				value.type = JsonValue::Type::Number;
+				auto result = std::from_chars(mText.data() + mPos, mText.data() + mText.size(), value.number);
+				if (result.ec != std::errc()) fail("unexpected character");
+				mPos = result.ptr - mText.data();
+			}
+			return value;
+		}
+
+		std::string parseString() {
+			mPos++;
+			std::string result;
+			while (mPos < mText.size() && mText[mPos] != '"') {
+				char c = mText[mPos++];
+				if (c != '\\') {
+					result += c;
+					continue;
+				}
+				if (mPos >= mText.size()) break;
+
+				char escape = mText[mPos++];
+				switch (escape) {
+				case 'b': result += '\b'; break;
+				case 'f': result += '\f'; break;
+				case 'n': result += '\n'; break;
+				case 'r': result += '\r'; break;
+				case 't': result += '\t'; break;
+				case 'u': appendUtf8(result, parseCodePoint()); break;
+				default: result += escape; break;
+				}
+			}
+			if (!consume("\"")) fail("unterminated string");
+			return result;
+		}
+
+		uint parseHex4() {
+			uint value = 0;
+			if (mPos + 4 > mText.size() || std::from_chars(mText.data() + mPos, mText.data() + mPos + 4, value, 16).ec != std::errc()) {
+				fail("invalid unicode escape");
+			}
+			mPos += 4;
+			return value;
+		}
+
+		uint parseCodePoint() {
+			uint codePoint = parseHex4();
+			// surrogate pair
+			if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume("\\u")) {
+				uint low = parseHex4();
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+			}
+			return codePoint;
+		}
+
+		static void appendUtf8(std::string& out, uint codePoint) {
+			if (codePoint < 0x80) {
+				out += (char)codePoint;
+			}
+			else if (codePoint < 0x800) {
+				out += (char)(0xC0 | (codePoint >> 6));
+				out += (char)(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000) {
+				out += (char)(0xE0 | (codePoint >> 12));
+				out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+				out += (char)(0x80 | (codePoint & 0x3F));
+			}
+			else {
+				out += (char)(0xF0 | (codePoint >> 18));
+				out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+				out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+				out += (char)(0x80 | (codePoint & 0x3F));
+			}
+		}
+
+	private:
+		std::string_view mText;
+		size_t mPos = 0;
+	};
+
+	static std::vector<uint8_t> decodeBase64(std::string_view text) {
+		auto decodeChar = [](char c) -> int {
+			if (c >= 'A' && c <= 'Z') return c - 'A';
+			if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+			if (c >= '0' && c <= '9') return c - '0' + 52;
+			if (c == '+') return 62;
+			if (c == '/') return 63;
+			return -1;
+		};
+
+		std::vector<uint8_t> bytes;
+		bytes.reserve(text.size() * 3 / 4);
+		uint accumulator = 0;
+		int bits = 0;
+		for (char c : text) {
+			int value = decodeChar(c);
+			if (value < 0) continue; // padding and line breaks
+			accumulator = (accumulator << 6) | (uint)value;
+			bits += 6;
+			if (bits >= 8) {
+				bits -= 8;
+				bytes.push_back((uint8_t)(accumulator >> bits));
+			}
+		}
+		return bytes;
+	}
+
+	struct GltfDocument {
+		JsonValue json;
+		std::vector<std::span<const uint8_t>> buffers;
+
+		// backing memory of the buffers
+		std::unique_ptr<MappedFile> container;
+		std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+		std::vector<std::vector<uint8_t>> decodedBuffers;
+	};
+
+	static GltfDocument readGltf(const std::filesystem::path& path) {
+		GltfDocument document;
+		document.container = std::make_unique<MappedFile>(path);
+		const uint8_t* data = document.container->data();
+		size_t size = document.container->size();
+
+		auto fail = [&](const std::string& reason) {
+			throw std::runtime_error("invalid glTF file '" + path.string() + "': " + reason);
+		};
+
+		std::string_view jsonText;
+		std::span<const uint8_t> binChunk;
+
+		auto readUint = [&](size_t offset) {
+			uint value;
+			memcpy(&value, data + offset, sizeof(value));
+			return value;
+		};
+
+		// binary container: 12 byte header, then chunks of length, type and data
+		if (size >= 12 && readUint(0) == 0x46546C67) {
+			if (readUint(4) != 2) fail("only version 2 is supported");
+
+			size_t offset = 12;
+			while (offset + 8 <= size) {
+				uint chunkLength = readUint(offset);
+				uint chunkType = readUint(offset + 4);
+				offset += 8;
+				if (chunkLength > size - offset) fail("truncated chunk");
+
+				if (chunkType == 0x4E4F534A) {
+					jsonText = { reinterpret_cast<const char*>(data + offset), chunkLength };
+				}
+				else if (chunkType == 0x004E4942) {
+					binChunk = { data + offset, chunkLength };
+				}
+				offset += (chunkLength + 3) & ~3u;
+			}
+			if (jsonText.empty()) fail("no JSON chunk");
+		}
+		else {
+			jsonText = { reinterpret_cast<const char*>(data), size };
+		}
+
+		document.json = JsonParser(jsonText).parse();
+		if (!document.json["asset"]["version"].string.starts_with("2")) fail("only version 2 is supported");
+
+		const JsonValue& buffers = document.json["buffers"];
+		for (size_t i = 0; i < buffers.size(); i++) {
+			const JsonValue& buffer = buffers[i];
+			size_t byteLength = buffer["byteLength"].integerOr(0);
+			std::span<const uint8_t> bytes;
+
+			if (!buffer.has("uri")) {
+				// the first buffer of a .glb without uri is its binary chunk
+				bytes = binChunk;
+			}
+			else if (buffer["uri"].string.starts_with("data:")) {
+				const std::string& uri = buffer["uri"].string;
+				size_t dataStart = uri.find(";base64,");
+				if (dataStart == std::string::npos) fail("only base64 data URIs are supported");
+				document.decodedBuffers.push_back(decodeBase64(std::string_view(uri).substr(dataStart + 8)));
+				bytes = document.decodedBuffers.back();
+			}
+			else {
+				document.bufferFiles.push_back(std::make_unique<MappedFile>(path.parent_path() / buffer["uri"].string));
+				bytes = { document.bufferFiles.back()->data(), document.bufferFiles.back()->size() };
+			}
+
+			if (bytes.size() < byteLength) fail("buffer " + std::to_string(i) + " is smaller than its byteLength");
+			document.buffers.push_back(bytes.first(byteLength));
+		}
+		return document;
+	}
+
+	struct GltfAccessor {
+		const uint8_t* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+		uint componentType = 0;
+		uint components = 0;
+		bool normalized = false;
+	};
+
+	static uint gltfComponentSize(uint componentType) {
+		switch (componentType) {
+		case 5120: case 5121: return 1;
+		case 5122: case 5123: return 2;
+		case 5125: case 5126: return 4;
+		default: return 0;
+		}
+	}
+
+	static uint gltfComponentCount(const std::string& type) {
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	static GltfAccessor gltfAccessor(const GltfDocument& document, size_t index) {
+		const JsonValue& accessor = document.json["accessors"][index];
+		const JsonValue& view = document.json["bufferViews"][accessor["bufferView"].index()];
+
+		GltfAccessor result{};
+		result.count = accessor["count"].integerOr(0);
+		result.componentType = (uint)std::min<size_t>(accessor["componentType"].integerOr(0), 0xffff);
+		result.components = gltfComponentCount(accessor["type"].string);
+		result.normalized = accessor["normalized"].boolean;
+
+		uint elementSize = gltfComponentSize(result.componentType) * result.components;
+		if (elementSize == 0) throw std::runtime_error("unsupported glTF accessor " + std::to_string(index));
+		if (accessor.has("sparse") || view.type == JsonValue::Type::Null) throw std::runtime_error("glTF accessor " + std::to_string(index) + " has no plain buffer view");
+
+		size_t bufferIndex = view["buffer"].index();
+		if (bufferIndex >= document.buffers.size()) throw std::runtime_error("glTF buffer view references a missing buffer");
+
+		size_t viewOffset = view["byteOffset"].integerOr(0);
+		size_t viewLength = view["byteLength"].integerOr(0);
+		size_t accessorOffset = accessor["byteOffset"].integerOr(0);
+		result.stride = view["byteStride"].integerOr(elementSize);
+
+		// compared by division, the products of untrusted counts and strides could wrap
+		auto outOfBounds = [&]() {
+			std::span<const uint8_t> buffer = document.buffers[bufferIndex];
+			if (viewOffset > buffer.size() || viewLength > buffer.size() - viewOffset) return true;
+			if (result.stride < elementSize) return true;
+			if (result.count == 0) return false;
+			if (accessorOffset > viewLength || elementSize > viewLength - accessorOffset) return true;
+			return result.count - 1 > (viewLength - accessorOffset - elementSize) / result.stride;
+		};
+		if (outOfBounds()) {
+			throw std::runtime_error("glTF accessor " + std::to_string(index) + " is out of bounds");
+		}
+
+		result.data = document.buffers[bufferIndex].data() + viewOffset + accessorOffset;
+		return result;
+	}
+
+	// element i as floats, normalized integers are mapped to [0, 1] or [-1, 1]
+	static void gltfRead(const GltfAccessor& accessor, size_t i, float* out) {
+		const uint8_t* element = accessor.data + accessor.stride * i;
+		for (uint c = 0; c < accessor.components; c++) {
+			switch (accessor.componentType) {
+			case 5120: { int8_t v; memcpy(&v, element + c, 1); out[c] = accessor.normalized ? std::max(v / 127.f, -1.f) : v; break; }
+			case 5121: { uint8_t v = element[c]; out[c] = accessor.normalized ? v / 255.f : v; break; }
+			case 5122: { int16 v; memcpy(&v, element + c * 2, 2); out[c] = accessor.normalized ? std::max(v / 32767.f, -1.f) : v; break; }
+			case 5123: { uint16 v; memcpy(&v, element + c * 2, 2); out[c] = accessor.normalized ? v / 65535.f : v; break; }
+			case 5125: { uint v; memcpy(&v, element + c * 4, 4); out[c] = (float)v; break; }
+			case 5126: memcpy(&out[c], element + c * 4, 4); break;
+			}
+		}
+	}
+
+	static uint gltfReadIndex(const GltfAccessor& accessor, size_t i) {
+		const uint8_t* element = accessor.data + accessor.stride * i;
+		switch (accessor.componentType) {
+		case 5121: return element[0];
+		case 5123: { uint16 v; memcpy(&v, element, 2); return v; }
+		case 5125: { uint v; memcpy(&v, element, 4); return v; }
+		default: throw std::runtime_error("glTF indices have to be unsigned integers");
+		}
+	}
+
+	// identical vertices of primitives without indices are merged
+	struct GltfVertexKey {
+		glm::vec3 position;
+		glm::vec4 color;
+		glm::vec2 texCoord;
+
+		bool operator==(const GltfVertexKey& other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+	};
+
+	struct GltfVertexKeyHash {
+		size_t operator()(const GltfVertexKey& key) const {
+			// FNV-1a over the raw floats
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&key);
+			uint64 hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(key); i++) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return (size_t)hash;
+		}
+	};
+
+	static ModelMeshData decodeGltfPrimitive(const GltfDocument& document, const JsonValue& primitive, std::string name) {
+		const JsonValue& attributes = primitive["attributes"];
+		if (!attributes.has("POSITION")) throw std::runtime_error("glTF primitive without positions");
+
+		GltfAccessor positions = gltfAccessor(document, attributes["POSITION"].index());
+		std::optional<GltfAccessor> colors;
+		std::optional<GltfAccessor> texCoords;
+		if (attributes.has("COLOR_0")) colors = gltfAccessor(document, attributes["COLOR_0"].index());
+		if (attributes.has("TEXCOORD_0")) texCoords = gltfAccessor(document, attributes["TEXCOORD_0"].index());
+
+		// gltfRead writes every component, more than the vertex attribute holds would overflow it
+		if (positions.components != 3 || (colors && (colors->components < 3 || colors->components > 4)) || (texCoords && texCoords->components != 2)) {
+			throw std::runtime_error("glTF primitive '" + name + "' has attributes of unsupported types");
+		}
+		if ((colors && colors->count != positions.count) || (texCoords && texCoords->count != positions.count)) {
+			throw std::runtime_error("glTF primitive '" + name + "' has mismatching attributes");
+		}
+
+		ModelMeshData mesh;
+		mesh.name = std::move(name);
+		mesh.positions.resize(positions.count);
+		mesh.colors.resize(positions.count, glm::vec4(1.f));
+		mesh.texCoords.resize(positions.count, glm::vec2(0.f));
+
+		for (size_t i = 0; i < positions.count; i++) {
+			gltfRead(positions, i, &mesh.positions[i].x);
+			// vec3 colors keep the alpha of 1
+			if (colors) gltfRead(*colors, i, &mesh.colors[i].x);
+			if (texCoords) gltfRead(*texCoords, i, &mesh.texCoords[i].x);
+		}
+
+		if (primitive.has("indices")) {
+			GltfAccessor indices = gltfAccessor(document, primitive["indices"].index());
+			mesh.indices.resize(indices.count - indices.count % 3);
+			for (size_t i = 0; i < mesh.indices.size(); i++) {
+				mesh.indices[i] = gltfReadIndex(indices, i);
+				if (mesh.indices[i] >= positions.count) throw std::runtime_error("glTF index out of range in '" + mesh.name + "'");
+			}
+			return mesh;
+		}
+
+		ModelMeshData unique;
+		unique.name = std::move(mesh.name);
+		std::unordered_map<GltfVertexKey, uint, GltfVertexKeyHash> vertices;
+		vertices.reserve(positions.count);
+		for (size_t i = 0; i < positions.count - positions.count % 3; i++) {
+			GltfVertexKey key{ mesh.positions[i], mesh.colors[i], mesh.texCoords[i] };
+			auto [it, inserted] = vertices.try_emplace(key, (uint)unique.positions.size());
+			if (inserted) {
+				unique.positions.push_back(key.position);
+				unique.colors.push_back(key.color);
+				unique.texCoords.push_back(key.texCoord);
+			}
+			unique.indices.push_back(it->second);
+		}
+		return unique;
+	}
+
+	std::vector<ModelMeshData> ModelImporter::loadGltf(const std::filesystem::path& path) {
+		GltfDocument document = readGltf(path);
+
+		static constexpr uint sTrianglesMode = 4;
+
+		std::vector<std::future<ModelMeshData>> decoded;
+		const JsonValue& meshes = document.json["meshes"];
+		for (size_t m = 0; m < meshes.size(); m++) {
+			const JsonValue& mesh = meshes[m];
+			const JsonValue& primitives = mesh["primitives"];
+			std::string meshName = mesh.has("name") ? mesh["name"].string : "mesh" + std::to_string(m);
+
+			for (size_t p = 0; p < primitives.size(); p++) {
+				const JsonValue& primitive = primitives[p];
+				if (primitive["mode"].integerOr(sTrianglesMode) != sTrianglesMode) {
+					CP_DEBUG_LOG("skipping non triangle primitive %zu of glTF mesh '%s'", p, meshName.c_str());
+					continue;
+				}
+
+				std::string name = primitives.size() > 1 ? meshName + "." + std::to_string(p) : meshName;
+				decoded.push_back(mPool.submit([&document, &primitive, name]() {
+					return decodeGltfPrimitive(document, primitive, name);
+				}));
+			}
+		}
+
+		std::vector<ModelMeshData> result = collectResults(decoded);
+		std::erase_if(result, [](const ModelMeshData& mesh) { return mesh.indices.empty(); });
+		return result;
+	}
+}
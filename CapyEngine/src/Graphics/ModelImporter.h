@@ -0,0 +1,74 @@
+#pragma once
+#include <Threading/ThreadPool.h>
+#include "Mesh.h"
+
+namespace cp {
+	// CPU side of an imported mesh, attributes missing from the file are white and (0, 0)
+	struct ModelMeshData {
+		std::string name;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec4> colors;
+		std::vector<glm::vec2> texCoords;
+		std::vector<uint> indices;
+		// empty unless LODs were generated, indices then holds every level one after another
+		std::vector<MeshLod> lods;
+	};
+
+	struct ModelImportSettings {
+		// 0 uses every hardware thread
+		uint threads = 0;
+		// OBJ files are split into chunks of about this many bytes, each parsed on its own thread
+		size_t chunkSize = 4 << 20;
+		// vertex cache, overdraw and vertex fetch order, see MeshOptimizer
+		bool optimize = true;
+		// adds a simplified LOD chain to every mesh, see MeshSimplifier
+		bool generateLods = false;
+		LodChainSettings lodSettings{};
+		MeshCpuData cpuData = MeshCpuData::Release;
+	};
+
+	// of the last import
+	struct ModelImportStatistics {
+		size_t meshes = 0;
+		size_t vertices = 0;
+		size_t triangles = 0;
+		// parsing, vertex deduplication and the optional optimization passes
+		float parseMs = 0.f;
+		// mesh creation and the upload
+		float uploadMs = 0.f;
+	};
+
+	template <class VertexT>
+	struct ImportedMesh {
+		std::string name;
+		std::unique_ptr<Mesh<VertexT>> mesh;
+	};
+
+	// Loads Wavefront OBJ and glTF 2.0 (.gltf with external or embedded buffers, .glb) files.
+	// OBJ objects and groups become separate meshes, so does every triangle primitive of a glTF mesh.
+	// glTF node transforms are not applied, meshes stay in their own space. Texture coordinates
+	// follow the glTF convention of v pointing down, OBJ texture coordinates are flipped to match.
+	class ModelImporter {
+	public:
+		explicit ModelImporter(const ModelImportSettings& settings = {});
+
+		// parses on the importer's threads, throws std::runtime_error on malformed files
+		std::vector<ModelMeshData> load(const std::filesystem::path& path);
+
+		// PositionColorVertex or SpriteVertex, every mesh is queued on the uploader and flushed once
+		template <class VertexT>
+		std::vector<ImportedMesh<VertexT>> import(const std::filesystem::path& path);
+
+		const ModelImportStatistics& statistics() const { return mStats; }
+
+	private:
+		std::vector<ModelMeshData> loadObj(const std::filesystem::path& path);
+		std::vector<ModelMeshData> loadGltf(const std::filesystem::path& path);
+		void finishMeshes(std::vector<ModelMeshData>& meshes);
+
+	private:
+		ModelImportSettings mSettings;
+		ThreadPool mPool;
+		ModelImportStatistics mStats{};
+	};
+}
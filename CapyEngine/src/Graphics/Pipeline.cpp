@@ -2,8 +2,8 @@
 #include <Application.h>
 
 namespace cp {
-	Pipeline::Pipeline(Device& device, Swapchain& swapchain, const PipelineConfiguration& config)
-		: mDevice(device), mSwapchain(swapchain), mConfig(config) {
+	Pipeline::Pipeline(Device& device, RenderTarget& target, const PipelineConfiguration& config)
+		: mDevice(device), mTarget(target), mConfig(config) {
 
 		CP_ASSERT(mConfig.pShader != nullptr, "cannot create pipeline with null shader, set pShader in PipelineConfiguration");
 		setShaderStages(*mConfig.pShader);
@@ -39,24 +39,38 @@ namespace cp {
 		dynamicStateInfo.dynamicStateCount = (uint)mDynamicStates.size();
 		dynamicStateInfo.pDynamicStates = mDynamicStates.data();
 
-		VkVertexInputBindingDescription bindingDesc{};
+		std::vector<VkVertexInputBindingDescription> bindingDescs;
 		AttributeDescriptions attribDescs;
 
 		switch (mConfig.vertexType) {
 		case PipelineConfiguration::PositionColorVertex:
-			bindingDesc = PositionColorVertex::bindingDescription();
+			bindingDescs.push_back(PositionColorVertex::bindingDescription());
 			attribDescs = PositionColorVertex::attributeDescriptions();
 			break;
 		case PipelineConfiguration::TexCoordVertex:
-			bindingDesc = SpriteVertex::bindingDescription();
+			bindingDescs.push_back(SpriteVertex::bindingDescription());
 			attribDescs = SpriteVertex::attributeDescriptions();
 			break;
+		case PipelineConfiguration::PackedPositionColorVertex:
+			bindingDescs.push_back(PackedPositionColorVertex::bindingDescription());
+			attribDescs = PackedPositionColorVertex::attributeDescriptions();
+			break;
+		case PipelineConfiguration::PackedTexCoordVertex:
+			bindingDescs.push_back(PackedSpriteVertex::bindingDescription());
+			attribDescs = PackedSpriteVertex::attributeDescriptions();
+			break;
+		}
+
+		if (mConfig.instancingEnabled) {
+			AttributeDescriptions instanceAttribDescs = InstanceData::attributeDescriptions();
+			bindingDescs.push_back(InstanceData::bindingDescription());
+			attribDescs.insert(attribDescs.end(), instanceAttribDescs.begin(), instanceAttribDescs.end());
 		}
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
+		vertexInputInfo.vertexBindingDescriptionCount = (uint)bindingDescs.size();
+		vertexInputInfo.pVertexBindingDescriptions = bindingDescs.data();
 		vertexInputInfo.vertexAttributeDescriptionCount = (uint)attribDescs.size();
 		vertexInputInfo.pVertexAttributeDescriptions = attribDescs.data();
 
@@ -68,14 +82,14 @@ namespace cp {
 		VkViewport baseViewport{};
 		baseViewport.x = 0.0f;
 		baseViewport.y = 0.0f;
-		baseViewport.width = (float)mSwapchain.extent().width;
-		baseViewport.height = (float)mSwapchain.extent().height;
+		baseViewport.width = (float)mTarget.extent().width;
+		baseViewport.height = (float)mTarget.extent().height;
 		baseViewport.minDepth = 0.0f;
 		baseViewport.maxDepth = 1.0f;
 
 		VkRect2D baseScissor{};
 		baseScissor.offset = { 0, 0 };
-		baseScissor.extent = mSwapchain.extent();
+		baseScissor.extent = mTarget.extent();
 
 		VkPipelineViewportStateCreateInfo viewportInfo{};
 		viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -163,7 +177,7 @@ namespace cp {
 		createInfo.renderPass = mRenderPass.vkHandle();
 		createInfo.subpass = 0;
 
-		VkResult pipelineResult = vkCreateGraphicsPipelines(mDevice.vkDevice(), VK_NULL_HANDLE, 1, &createInfo, nullptr, &mPipeline);
+		VkResult pipelineResult = vkCreateGraphicsPipelines(mDevice.vkDevice(), mDevice.pipelineCache(), 1, &createInfo, nullptr, &mPipeline);
 		checkVkResult(pipelineResult, "couldn't create a graphics pipeline");
 	}
 }
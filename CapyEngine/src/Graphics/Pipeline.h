@@ -1,6 +1,6 @@
 #pragma once
 #include <Vulkan/Device.h>
-#include <Vulkan/Swapchain.h>
+#include <Vulkan/RenderTarget.h>
 #include "Shader.h"
 #include "RenderPass.h"
 #include "Vertex.h"
@@ -10,12 +10,19 @@ namespace cp {
 		enum VertexType {
 			PositionColorVertex,
 			TexCoordVertex,
+			// quantized layouts, meshes fold the dequantization into the model matrix
+			PackedPositionColorVertex,
+			PackedTexCoordVertex,
 		};
 
 		VertexType vertexType = PositionColorVertex;
 		bool backCullingEnabled = false;
 		bool wireframeMode = false;
 
+		// model matrices come from a per-instance vertex buffer (InstanceData) instead of push constants,
+		// shader has to declare them as a mat4 input at InstanceData::firstLocation
+		bool instancingEnabled = false;
+
 		Shader* pShader;
 
 		struct DescriptorSetBinding {
@@ -28,7 +35,7 @@ namespace cp {
 
 	class Pipeline {
 	public:
-		Pipeline(Device& device, Swapchain& swapchain, const PipelineConfiguration& config = {});
+		Pipeline(Device& device, RenderTarget& target, const PipelineConfiguration& config = {});
 		~Pipeline();
 
 		VkPipeline vkHandle() const { return mPipeline; }
@@ -44,11 +51,11 @@ namespace cp {
 		PipelineConfiguration mConfig;
 
 		Device& mDevice;
-		Swapchain& mSwapchain;
+		RenderTarget& mTarget;
 		VkPipeline mPipeline = VK_NULL_HANDLE;
 		VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
 		VkDescriptorSetLayout mDescSetLayout = VK_NULL_HANDLE;
-		RenderPass mRenderPass{ mDevice, mSwapchain };
+		RenderPass mRenderPass{ mDevice, mTarget };
 
 		VkPipelineShaderStageCreateInfo mVertexShaderStage{};
 		VkPipelineShaderStageCreateInfo mFragmentShaderStage{};
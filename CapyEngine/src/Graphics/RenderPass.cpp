@@ -1,8 +1,8 @@
 #include "RenderPass.h"
 
 namespace cp {
-	RenderPass::RenderPass(Device& device, Swapchain& swapchain)
-		: mDevice(device), mSwapchain(swapchain) {
+	RenderPass::RenderPass(Device& device, RenderTarget& target)
+		: mDevice(device), mTarget(target) {
 		create();
 	}
 
@@ -12,14 +12,14 @@ namespace cp {
 
 	void RenderPass::create() {
 		VkAttachmentDescription attachment{};
-		attachment.format = mSwapchain.format().format;
+		attachment.format = mTarget.colorFormat();
 		attachment.samples = VK_SAMPLE_COUNT_1_BIT;
 		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		attachment.finalLayout = mTarget.finalLayout();
 
 		VkAttachmentReference ref{};
 		ref.attachment = 0;
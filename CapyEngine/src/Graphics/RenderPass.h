@@ -1,11 +1,11 @@
 #pragma once
 #include <Vulkan/Device.h>
-#include <Vulkan/Swapchain.h>
+#include <Vulkan/RenderTarget.h>
 
 namespace cp {
 	class RenderPass {
 	public:
-		RenderPass(Device& device, Swapchain& swapchain);
+		RenderPass(Device& device, RenderTarget& target);
 		~RenderPass();
 
 		VkRenderPass vkHandle() const { return mPass; }
@@ -15,7 +15,7 @@ namespace cp {
 
 	private:
 		Device& mDevice;
-		Swapchain& mSwapchain;
+		RenderTarget& mTarget;
 		VkRenderPass mPass = VK_NULL_HANDLE;
 	};
 }
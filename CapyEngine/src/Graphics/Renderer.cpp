@@ -1,16 +1,21 @@
 #include "Renderer.h"
 
 namespace cp {
+	// packets that can be drawn by one instanced draw
+	static bool sameBatch(const DrawPacket& a, const DrawPacket& b) {
+		return a.pipeline == b.pipeline && a.geometry == b.geometry && a.scope == b.scope && a.drawData == b.drawData;
+	}
+
 	Renderer::Renderer(
 		Device& device,
-		Swapchain& swapchain,
+		RenderTarget& target,
 		EventHandler& evtHandler,
 		const RendererConfiguration& config
 	)
-		: mDevice(device), mSwapchain(swapchain), mConfig(config) {
+		: mDevice(device), mTarget(target), mConfig(config) {
 
-		mViewportWidth = mSwapchain.extent().width;
-		mViewportHeight = mSwapchain.extent().height;
+		mViewportWidth = mTarget.extent().width;
+		mViewportHeight = mTarget.extent().height;
 
 		init();
 		createSyncObjects();
@@ -21,10 +26,21 @@ namespace cp {
 	}
 
 	Renderer::~Renderer() {
+		// background compiles create objects on the device, they have to be done before it can be idle
+		for (PendingPipeline& pending : mPendingPipelines) {
+			pending.pipeline.wait();
+		}
+
 		vkDestroyCommandPool(mDevice.vkDevice(), mCmdPool, nullptr);
 		vkDestroyDescriptorPool(mDevice.vkDevice(), mDescriptorPool, nullptr);
 		CP_DEBUG_LOG("command pool destroyed");
 
+		for (const auto& framePools : mWorkerCmdPools) {
+			for (VkCommandPool pool : framePools) {
+				vkDestroyCommandPool(mDevice.vkDevice(), pool, nullptr);
+			}
+		}
+
 		for (size_t i = 0; i < mConfig.framesInFlight; i++) {
 			vkDestroySemaphore(mDevice.vkDevice(), mImageAvailSemaphores[i], nullptr);
 			vkDestroySemaphore(mDevice.vkDevice(), mRenderFinishedSemaphores[i], nullptr);
@@ -34,151 +50,373 @@ namespace cp {
 	}
 
 	PipelineHandle Renderer::addPipelineConfiguration(PipelineConfiguration& config) {
+		PipelineHandle handle = reservePipeline(config, {});
+		installPipeline(handle.id, std::make_unique<Pipeline>(mDevice, mTarget, config));
+		return handle;
+	}
+
+	std::vector<PipelineHandle> Renderer::addPipelineConfigurations(std::span<PipelineConfiguration> configs) {
+		std::vector<PipelineHandle> handles;
+		std::vector<std::future<std::unique_ptr<Pipeline>>> compiled;
+		handles.reserve(configs.size());
+		compiled.reserve(configs.size());
+
+		for (PipelineConfiguration& config : configs) {
+			handles.push_back(reservePipeline(config, {}));
+			compiled.push_back(compilePipeline(config));
+		}
+		for (size_t i = 0; i < handles.size(); i++) {
+			installPipeline(handles[i].id, compiled[i].get());
+		}
+		return handles;
+	}
+
+	PipelineHandle Renderer::addPipelineConfigurationAsync(PipelineConfiguration& config, PipelineHandle fallback) {
+		CP_ASSERT(
+			fallback.id == PipelineHandle{}.id || (fallback.id < mPipelines.size() &&
+				mPipelineConfigs[fallback.id].vertexType == config.vertexType &&
+				mPipelineConfigs[fallback.id].instancingEnabled == config.instancingEnabled),
+			"fallback pipeline has to exist and take the same vertex layout"
+		);
+
+		PipelineHandle handle = reservePipeline(config, fallback);
+		mPendingPipelines.push_back({ handle.id, compilePipeline(config) });
+		return handle;
+	}
+
+	PipelineHandle Renderer::reservePipeline(PipelineConfiguration& config, PipelineHandle fallback) {
 		config.descriptorSetBindings = {
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT } // Matrix uniform
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT }, // Matrix uniform
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT }, // Per-draw data
 		};
-		mPipelines.push_back(std::make_unique<Pipeline>(mDevice, mSwapchain, config));
+		mPipelines.emplace_back();
+		mPipelineConfigs.push_back(config);
+		mPipelineFallbacks.push_back(fallback.id);
 		return { (uint)mPipelines.size() - 1 };
 	}
 
+	std::future<std::unique_ptr<Pipeline>> Renderer::compilePipeline(const PipelineConfiguration& config) {
+		if (!mCompilePool) {
+			uint threads = mConfig.pipelineCompileThreads > 0 ? mConfig.pipelineCompileThreads : std::max(std::thread::hardware_concurrency(), 1u);
+			mCompilePool = std::make_unique<ThreadPool>(threads);
+		}
+
+		CP_ASSERT(config.pShader != nullptr, "cannot create pipeline with null shader, set pShader in PipelineConfiguration");
+
+		// the task holds its own copy of the Shader and with it the modules, the caller's can be gone by the time it runs.
+		// The pipeline cache of the device is internally synchronized, workers share it
+		return mCompilePool->submit([this, config = config, shader = *config.pShader]() mutable {
+			config.pShader = &shader;
+			return std::make_unique<Pipeline>(mDevice, mTarget, config);
+		});
+	}
+
+	void Renderer::installPipeline(uint pipelineId, std::unique_ptr<Pipeline> pipeline) {
+		mPipelines[pipelineId] = std::move(pipeline);
+
+		// all pipelines share the same set layout, the first one to finish provides it
+		if (mDescriptorSet == VK_NULL_HANDLE) {
+			createDescriptorSets(pipelineId);
+		}
+	}
+
+	void Renderer::collectPipelines() {
+		// only swapped in between frames, recording threads never see the pipelines change
+		std::erase_if(mPendingPipelines, [this](PendingPipeline& pending) {
+			if (pending.pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+			installPipeline(pending.id, pending.pipeline.get());
+			return true;
+		});
+	}
+
+	uint Renderer::drawablePipeline(uint pipelineId) const {
+		// fallbacks are always added before the pipelines using them, the chain can't loop
+		while (pipelineId < mPipelines.size() && !mPipelines[pipelineId]) {
+			pipelineId = mPipelineFallbacks[pipelineId];
+		}
+		return pipelineId;
+	}
+
 	void Renderer::usePipeline(PipelineHandle handle) {
 		CP_ASSERT(handle.id < mPipelines.size(), "invalid pipeline handle");
 		mCurrentPipeline = handle;
-
-		if (mCurrentPipeline.id == 0) {
-			createDescriptorSets();
-		}
 	}
 
 	void Renderer::begin() {
+		if (!mPendingPipelines.empty()) {
+			collectPipelines();
+		}
 		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
 
 		vkWaitForFences(mDevice.vkDevice(), 1, &mInFlightFences[mCurrentFrame], VK_TRUE, std::numeric_limits<uint64>::max());
 
 		mImageIdx = 0;
-		VkResult nextImgResult = vkAcquireNextImageKHR(
-			mDevice.vkDevice(),
-			mSwapchain.vkHandle(),
-			std::numeric_limits<uint64>::max(),
-			mImageAvailSemaphores[mCurrentFrame],
-			VK_NULL_HANDLE,
-			&mImageIdx
-		);
-
-		if (nextImgResult == VK_ERROR_OUT_OF_DATE_KHR) {
-			recreateSwapchain();
-			return;
+		if (mTarget.presentable()) {
+			VkResult nextImgResult = vkAcquireNextImageKHR(
+				mDevice.vkDevice(),
+				static_cast<Swapchain&>(mTarget).vkHandle(),
+				std::numeric_limits<uint64>::max(),
+				mImageAvailSemaphores[mCurrentFrame],
+				VK_NULL_HANDLE,
+				&mImageIdx
+			);
+
+			if (nextImgResult == VK_ERROR_OUT_OF_DATE_KHR) {
+				recreateSwapchain();
+				return;
+			}
+			else if (nextImgResult != VK_SUCCESS && nextImgResult != VK_SUBOPTIMAL_KHR) {
+				throw std::runtime_error("failed to acquire swap chain image");
+			}
 		}
-		else if (nextImgResult != VK_SUCCESS && nextImgResult != VK_SUBOPTIMAL_KHR) {
-			throw std::runtime_error("failed to acquire swap chain image");
+		else {
+			// the frame fence guards the offscreen image as well
+			mImageIdx = mCurrentFrame % (uint)mFramebuffers.size();
 		}
 
 		vkResetFences(mDevice.vkDevice(), 1, &mInFlightFences[mCurrentFrame]);
 
 		vkResetCommandBuffer(mCmdBuffers[mCurrentFrame], 0);
 
+		// the region of this frame is free again now that its fence has been waited on
+		mFrameData->beginFrame(mCurrentFrame);
+		mFrameUniformOffset = mFrameData->push(ProjViewUBO{ mProjection, mView });
+		// the range of binding 1 stays inside the buffer, shaders only read it after setDrawData
+		mCurrentDrawData = mFrameUniformOffset;
+		mSkippedSubmissions = 0;
+		mRecording = true;
+
 		VkCommandBufferBeginInfo bufferBeginInfo{};
 		bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
 		VkResult beginResult = vkBeginCommandBuffer(mCmdBuffers[mCurrentFrame], &bufferBeginInfo);
 		checkVkResult(beginResult, "failed to begin command buffer");
 
-		VkRenderPassBeginInfo passBeginInfo{};
-		passBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		passBeginInfo.renderPass = mRenderPass->vkHandle();
-		passBeginInfo.framebuffer = mFramebuffers[mImageIdx].vkHandle();
-		passBeginInfo.renderArea.extent = mSwapchain.extent();
-		passBeginInfo.renderArea.offset = { 0, 0 };
+		if (mProfiler) {
+			mProfiler->beginFrame(mCmdBuffers[mCurrentFrame], mCurrentFrame);
+		}
+		mCurrentScope = 0;
+	}
 
-		VkClearValue clearColor = { {{ 0.f, 0.f, 0.f, 1.f }} };
-		passBeginInfo.clearValueCount = 1;
-		passBeginInfo.pClearValues = &clearColor;
+	void Renderer::beginGpuScope(std::string_view name) {
+		if (!mProfiler) return;
+		mCurrentScope = mProfiler->addScope(mCurrentFrame, name);
+	}
 
-		vkCmdBeginRenderPass(mCmdBuffers[mCurrentFrame], &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	void Renderer::endGpuScope() {
+		mCurrentScope = 0;
+	}
 
-		vkCmdBindPipeline(mCmdBuffers[mCurrentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines[mCurrentPipeline.id]->vkHandle());
+	const GpuFrameTimings& Renderer::gpuTimings() const {
+		static const GpuFrameTimings sDisabled{};
+		return mProfiler ? mProfiler->latest() : sDisabled;
+	}
 
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float)mViewportWidth;
-		viewport.height = (float)mViewportHeight;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(mCmdBuffers[mCurrentFrame], 0, 1, &viewport);
+	void Renderer::submitMesh(const Mesh<PositionColorVertex>& mesh, const Transform& tf) {
+		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
 
-		VkRect2D scissor{};
-		scissor.offset = { 0, 0 };
-		scissor.extent = mSwapchain.extent();
-		vkCmdSetScissor(mCmdBuffers[mCurrentFrame], 0, 1, &scissor);
+		CP_ASSERT(
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::PositionColorVertex,
+			"cannot submit mesh with vertex type PositionColorVertex with different pipeline configuration"
+		);
 
-		vkCmdBindDescriptorSets(
-			mCmdBuffers[mCurrentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			mPipelines[mCurrentPipeline.id]->layout(),
-			0, 1,
-			&mDescriptorSets[mCurrentFrame],
-			0, nullptr
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf, {}, mesh.lods());
+	}
+
+	void Renderer::submitMesh(const Mesh<SpriteVertex>& mesh, const Transform& tf) {
+		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
+
+		CP_ASSERT(
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::TexCoordVertex,
+			"cannot submit mesh with vertex type SpriteVertex with different pipeline configuration"
+		);
+
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf, {}, mesh.lods());
+	}
+
+	void Renderer::submitMesh(const Mesh<PackedPositionColorVertex>& mesh, const Transform& tf) {
+		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
+
+		CP_ASSERT(
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::PackedPositionColorVertex,
+			"cannot submit mesh with vertex type PackedPositionColorVertex with different pipeline configuration"
 		);
+
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf, mesh.quantization(), mesh.lods());
 	}
 
-	void Renderer::submitMesh(const Mesh<PositionColorVertex>& mesh, const Transform& tf) {
+	void Renderer::submitMesh(const Mesh<PackedSpriteVertex>& mesh, const Transform& tf) {
 		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
 
 		CP_ASSERT(
-			mPipelines[mCurrentPipeline.id]->configuration().vertexType == PipelineConfiguration::PositionColorVertex,
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::PackedTexCoordVertex,
+			"cannot submit mesh with vertex type PackedSpriteVertex with different pipeline configuration"
+		);
+
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf, mesh.quantization(), mesh.lods());
+	}
+
+	void Renderer::submitMesh(const DynamicMesh<PositionColorVertex>& mesh, const Transform& tf) {
+		if (mViewportWidth <= 0 || mViewportHeight <= 0 || mesh.indexCount() == 0) return;
+
+		CP_ASSERT(
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::PositionColorVertex,
 			"cannot submit mesh with vertex type PositionColorVertex with different pipeline configuration"
 		);
 
-		updateModelMatrix(tf.calcModelMatrix());
-		bindAndDrawBuffers(mesh.vertexBuffer(), mesh.indexBuffer());
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf);
 	}
 
-	void Renderer::submitMesh(const Mesh<SpriteVertex>& mesh, const Transform& tf) {
+	void Renderer::submitMesh(const DynamicMesh<SpriteVertex>& mesh, const Transform& tf) {
+		if (mViewportWidth <= 0 || mViewportHeight <= 0 || mesh.indexCount() == 0) return;
+
+		CP_ASSERT(
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::TexCoordVertex,
+			"cannot submit mesh with vertex type SpriteVertex with different pipeline configuration"
+		);
+
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf);
+	}
+
+	void Renderer::submitMesh(const PooledMesh<PositionColorVertex>& mesh, const Transform& tf) {
 		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
 
 		CP_ASSERT(
-			mPipelines[mCurrentPipeline.id]->configuration().vertexType == PipelineConfiguration::TexCoordVertex,
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::PositionColorVertex,
+			"cannot submit mesh with vertex type PositionColorVertex with different pipeline configuration"
+		);
+
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf);
+	}
+
+	void Renderer::submitMesh(const PooledMesh<SpriteVertex>& mesh, const Transform& tf) {
+		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
+
+		CP_ASSERT(
+			mPipelineConfigs[mCurrentPipeline.id].vertexType == PipelineConfiguration::TexCoordVertex,
 			"cannot submit mesh with vertex type SpriteVertex with different pipeline configuration"
 		);
 
-		updateModelMatrix(tf.calcModelMatrix());
-		bindAndDrawBuffers(mesh.vertexBuffer(), mesh.indexBuffer());
+		submitPacket(mesh.id(), mesh.geometry(), mesh.boundingSphere(), tf);
+	}
+
+	void Renderer::submitPacket(
+		uint meshId,
+		const DrawGeometry& geometry,
+		const BoundingSphere& bounds,
+		const Transform& tf,
+		const VertexQuantization& quantization,
+		std::span<const MeshLod> lods
+	) {
+		uint pipeline = drawablePipeline(mCurrentPipeline.id);
+		if (pipeline >= mPipelines.size()) {
+			mSkippedSubmissions++;
+			return;
+		}
+
+		DrawPacket packet{};
+		packet.pipeline = pipeline;
+		packet.scope = mCurrentScope;
+		packet.drawData = mCurrentDrawData;
+		packet.geometry = geometry;
+		packet.model = tf.calcModelMatrix();
+		packet.bounds = bounds;
+
+		if (lods.size() > 1) {
+			const MeshLod& lod = lods[selectLod(lods, bounds, packet.model)];
+			packet.geometry.firstIndex = lod.firstIndex;
+			packet.geometry.indexCount = lod.indexCount;
+		}
+
+		// packed positions are dequantized by the model matrix, the bounds move into packed space with them
+		if (!quantization.identity()) {
+			packet.model = packet.model * quantization.matrix();
+			packet.bounds = { (bounds.center - quantization.offset) / quantization.scale, bounds.radius / quantization.scale };
+		}
+
+		float viewDepth = -(mView * packet.model[3]).z;
+		packet.sortKey = DrawList::makeSortKey(packet.pipeline, meshId, viewDepth, packet.scope);
+
+		mDrawList.add(packet);
+	}
+
+	uint Renderer::selectLod(std::span<const MeshLod> lods, const BoundingSphere& bounds, const glm::mat4& model) const {
+		if (mConfig.lodErrorPixels <= 0.f) return 0;
+
+		// errors are in mesh space, the largest axis scale of the model bounds how much they grow
+		float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+
+		// projection[1][1] is the cotangent of half the vertical field of view, orthographic projections
+		// have no perspective divide and keep a constant size
+		float pixelsPerUnit = mProjection[1][1] * mViewportHeight * 0.5f;
+		if (mProjection[2][3] != 0.f) {
+			glm::vec3 center = glm::vec3(mView * model * glm::vec4(bounds.center, 1.f));
+			float distance = glm::length(center) - bounds.radius * scale;
+			// the camera is inside the bounds
+			if (distance <= 0.f) return 0;
+			pixelsPerUnit /= distance;
+		}
+
+		for (uint lod = (uint)lods.size() - 1; lod > 0; lod--) {
+			if (lods[lod].error * scale * pixelsPerUnit <= mConfig.lodErrorPixels) return lod;
+		}
+		return 0;
 	}
 
 
 	void Renderer::end() {
 		if (mViewportWidth <= 0 || mViewportHeight <= 0) return;
 
-		vkCmdEndRenderPass(mCmdBuffers[mCurrentFrame]);
+		recordDrawList();
+		mDrawList.clear();
+		mRecording = false;
+
+		if (mProfiler) {
+			mProfiler->endFrame(mCmdBuffers[mCurrentFrame], mCurrentFrame);
+		}
 
 		VkResult endBufferResult = vkEndCommandBuffer(mCmdBuffers[mCurrentFrame]);
 		checkVkResult(endBufferResult, "failed to record command buffer");
 
+		// meshes created this frame have to be copied before the frame reads them
+		ResourceManager::flushUploads();
+
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
 		VkSemaphore waitSemaphores[] = { mImageAvailSemaphores[mCurrentFrame] };
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
+		VkSemaphore signalSemaphores[] = { mRenderFinishedSemaphores[mCurrentFrame] };
+
+		// offscreen images are never acquired or presented so there is nothing to wait on or signal
+		if (mTarget.presentable()) {
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = waitSemaphores;
+			submitInfo.pWaitDstStageMask = waitStages;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = signalSemaphores;
+		}
 
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &mCmdBuffers[mCurrentFrame];
 
-		VkSemaphore signalSemaphores[] = { mRenderFinishedSemaphores[mCurrentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = signalSemaphores;
-
 		VkResult submitResult = vkQueueSubmit(mDevice.graphicsQueue(), 1, &submitInfo, mInFlightFences[mCurrentFrame]);
 		checkVkResult(submitResult, "failed to submit to queue");
 
+		mLastFrame = mCurrentFrame;
+		mCurrentFrame = (mCurrentFrame + 1) % mConfig.framesInFlight;
+
+		if (mTarget.presentable()) {
+			present(signalSemaphores[0]);
+		}
+	}
+
+	void Renderer::present(VkSemaphore waitSemaphore) {
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = signalSemaphores;
-		VkSwapchainKHR swapChains[] = { mSwapchain.vkHandle() };
+		presentInfo.pWaitSemaphores = &waitSemaphore;
+		VkSwapchainKHR swapChains[] = { static_cast<Swapchain&>(mTarget).vkHandle() };
 		presentInfo.swapchainCount = 1;
 		presentInfo.pSwapchains = swapChains;
 		presentInfo.pImageIndices = &mImageIdx;
@@ -190,12 +428,17 @@ namespace cp {
 			return;
 		}
 		checkVkResult(presentResult, "failed to present image");
+	}
 
-		mCurrentFrame = (mCurrentFrame + 1) % mConfig.framesInFlight;
+	std::vector<uint8_t> Renderer::readback() {
+		CP_ASSERT(!mTarget.presentable(), "readback is only supported for offscreen render targets");
+
+		vkWaitForFences(mDevice.vkDevice(), 1, &mInFlightFences[mLastFrame], VK_TRUE, std::numeric_limits<uint64>::max());
+		return static_cast<OffscreenTarget&>(mTarget).readback(mLastFrame % (uint)mFramebuffers.size());
 	}
 
 	void Renderer::init() {
-		mRenderPass = std::make_unique<RenderPass>(mDevice, mSwapchain);
+		mRenderPass = std::make_unique<RenderPass>(mDevice, mTarget);
 
 		createFramebuffers();
 		
@@ -221,16 +464,87 @@ namespace cp {
 		checkVkResult(allocResult, "failed to allocate command buffers");
 
 		for (uint i = 0; i < mConfig.framesInFlight; i++) {
-			mMatrixUniformBuffers.push_back(std::make_unique<UniformBuffer<ProjViewUBO>>(mDevice));
+			mInstanceBuffers.push_back(std::make_unique<InstanceBuffer>(mDevice, 256));
+		}
+
+		mConfig.maxDrawDataSize = std::min(mConfig.maxDrawDataSize, mDevice.properties().limits.maxUniformBufferRange);
+		mFrameData = std::make_unique<FrameRingBuffer>(
+			mDevice,
+			mConfig.framesInFlight,
+			mConfig.frameDataSize,
+			std::max<VkDeviceSize>(mConfig.maxDrawDataSize, sizeof(ProjViewUBO)),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+		);
+
+		if (mConfig.indirectDrawing) {
+			// command slots are addressed by packet index which ends up in firstInstance
+			if (!mDevice.features().drawIndirectFirstInstance) {
+				CP_DEBUG_LOG("drawIndirectFirstInstance is not supported, falling back to direct draws");
+				mConfig.indirectDrawing = false;
+			}
+			else {
+				for (uint i = 0; i < mConfig.framesInFlight; i++) {
+					mIndirectBuffers.push_back(std::make_unique<IndirectBuffer>(mDevice, 256));
+				}
+			}
+		}
+
+		if (mConfig.gpuCulling) {
+			CP_ASSERT(mConfig.indirectDrawing, "gpu culling writes indirect commands, it requires indirectDrawing");
+			mCullingPass = std::make_unique<CullingPass>(mDevice, mConfig.framesInFlight, mConfig.cullingShaderPath);
+		}
+
+		if (mConfig.gpuProfiling && mDevice.timestampValidBits() == 0) {
+			CP_DEBUG_LOG("gpu profiling disabled, the graphics queue doesn't support timestamps");
+			mConfig.gpuProfiling = false;
+		}
+		if (mConfig.gpuProfiling) {
+			// secondary command buffers can only run inside an active statistics query with inheritedQueries
+			bool statistics = mConfig.pipelineStatistics && (mConfig.recordingThreads <= 1 || mDevice.features().inheritedQueries);
+			mProfiler = std::make_unique<GpuProfiler>(mDevice, mConfig.framesInFlight, std::min(mConfig.maxGpuScopes, 63u), statistics);
+		}
+
+		if (mConfig.recordingThreads > 1) {
+			mRecordingPool = std::make_unique<ThreadPool>(mConfig.recordingThreads);
+			createWorkerCommandBuffers();
+		}
+	}
+
+	void Renderer::createWorkerCommandBuffers() {
+		VkCommandPoolCreateInfo cmdPoolInfo{};
+		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolInfo.queueFamilyIndex = mDevice.queueFamilies().graphicsFamily.value();
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		// command pools are externally synchronized, so each worker gets its own pool per frame in flight
+		mWorkerCmdPools.resize(mConfig.framesInFlight);
+		mWorkerCmdBuffers.resize(mConfig.framesInFlight);
+		for (uint frame = 0; frame < mConfig.framesInFlight; frame++) {
+			mWorkerCmdPools[frame].resize(mConfig.recordingThreads);
+			mWorkerCmdBuffers[frame].resize(mConfig.recordingThreads);
+
+			for (uint worker = 0; worker < mConfig.recordingThreads; worker++) {
+				VkResult poolResult = vkCreateCommandPool(mDevice.vkDevice(), &cmdPoolInfo, nullptr, &mWorkerCmdPools[frame][worker]);
+				checkVkResult(poolResult, "failed to create worker command pool");
+
+				VkCommandBufferAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.commandPool = mWorkerCmdPools[frame][worker];
+				allocInfo.commandBufferCount = 1;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+				VkResult allocResult = vkAllocateCommandBuffers(mDevice.vkDevice(), &allocInfo, &mWorkerCmdBuffers[frame][worker]);
+				checkVkResult(allocResult, "failed to allocate secondary command buffer");
+			}
 		}
 	}
 
 	void Renderer::createFramebuffers() {
-		std::vector<Swapchain::Image> swapchainImages = mSwapchain.images();
-		VkExtent2D extent = mSwapchain.extent();
+		std::vector<RenderTarget::Image> targetImages = mTarget.images();
+		VkExtent2D extent = mTarget.extent();
 
-		mFramebuffers.reserve(swapchainImages.size());
-		for (const auto& image : swapchainImages) {
+		mFramebuffers.reserve(targetImages.size());
+		for (const auto& image : targetImages) {
 			FramebufferSpecification framebufferSpec{};
 			framebufferSpec.width = extent.width;
 			framebufferSpec.height = extent.height;
@@ -262,52 +576,47 @@ namespace cp {
 		}
 	}
 
-	void Renderer::createDescriptorSets() {
+	void Renderer::createDescriptorSets(uint pipelineId) {
 		VkDescriptorPoolSize poolSize{};
-		poolSize.descriptorCount = mConfig.framesInFlight;
-		poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		poolSize.descriptorCount = 2;
+		poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 
 		VkDescriptorPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		poolInfo.poolSizeCount = 1;
 		poolInfo.pPoolSizes = &poolSize;
-		poolInfo.maxSets = mConfig.framesInFlight;
+		poolInfo.maxSets = 1;
 
 		VkResult poolResult = vkCreateDescriptorPool(mDevice.vkDevice(), &poolInfo, nullptr, &mDescriptorPool);
 		checkVkResult(poolResult, "failed to create descriptor pool");
 
-		std::vector<VkDescriptorSetLayout> layouts(
-			mConfig.framesInFlight, 
-			mPipelines[mCurrentPipeline.id]->descriptorSetLayout()
-		);
+		VkDescriptorSetLayout layout = mPipelines[pipelineId]->descriptorSetLayout();
 
 		VkDescriptorSetAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		allocInfo.descriptorPool = mDescriptorPool;
-		allocInfo.descriptorSetCount = mConfig.framesInFlight;
-		allocInfo.pSetLayouts = layouts.data();
-
-		mDescriptorSets.resize(mConfig.framesInFlight);
-		VkResult setResult = vkAllocateDescriptorSets(mDevice.vkDevice(), &allocInfo, mDescriptorSets.data());
-		checkVkResult(setResult, "failed to allocate descriptor sets");
-
-		for (uint i = 0; i < mConfig.framesInFlight; i++) {
-			VkDescriptorBufferInfo descBufferInfo{};
-			descBufferInfo.buffer = mMatrixUniformBuffers[i]->vkHandle();
-			descBufferInfo.offset = 0;
-			descBufferInfo.range = mMatrixUniformBuffers[i]->uboSize();
-
-			VkWriteDescriptorSet descWrite{};
-			descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descWrite.dstSet = mDescriptorSets[i];
-			descWrite.dstBinding = 0;
-			descWrite.dstArrayElement = 0;
-			descWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descWrite.descriptorCount = 1;
-			descWrite.pBufferInfo = &descBufferInfo;
-
-			vkUpdateDescriptorSets(mDevice.vkDevice(), 1, &descWrite, 0, nullptr);
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		VkResult setResult = vkAllocateDescriptorSets(mDevice.vkDevice(), &allocInfo, &mDescriptorSet);
+		checkVkResult(setResult, "failed to allocate descriptor set");
+
+		std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+		bufferInfos[0] = { mFrameData->vkHandle(), 0, sizeof(ProjViewUBO) };
+		bufferInfos[1] = { mFrameData->vkHandle(), 0, mConfig.maxDrawDataSize };
+
+		std::array<VkWriteDescriptorSet, 2> descWrites{};
+		for (uint i = 0; i < descWrites.size(); i++) {
+			descWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descWrites[i].dstSet = mDescriptorSet;
+			descWrites[i].dstBinding = i;
+			descWrites[i].dstArrayElement = 0;
+			descWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+			descWrites[i].descriptorCount = 1;
+			descWrites[i].pBufferInfo = &bufferInfos[i];
 		}
+
+		vkUpdateDescriptorSets(mDevice.vkDevice(), (uint)descWrites.size(), descWrites.data(), 0, nullptr);
 	}
 
 	void Renderer::setViewportSize(int width, int height) {
@@ -316,32 +625,419 @@ namespace cp {
 	}
 
 	void Renderer::setProjView(const glm::mat4& projection, const glm::mat4& view) {
-		mMatrixUniformBuffers[mCurrentFrame]->update({ projection, view });
+		mProjection = projection;
+		mView = view;
+		mProjView = projection * view;
+
+		// set before begin the matrices are written once the frame slot is free,
+		// otherwise the frame gets its own copy right away
+		if (mRecording) {
+			mFrameUniformOffset = mFrameData->push(ProjViewUBO{ projection, view });
+		}
 	}
 
-	void Renderer::bindAndDrawBuffers(const VertexBuffer& vb, const IndexBuffer& ib) {
-		VkBuffer vertexBuffers[] = { vb.vkHandle() };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(mCmdBuffers[mCurrentFrame], 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(mCmdBuffers[mCurrentFrame], ib.vkHandle(), 0, VK_INDEX_TYPE_UINT16);
+	void Renderer::setDrawData(const void* data, size_t size) {
+		CP_ASSERT(mRecording, "draw data can only be set between begin and end");
+		CP_ASSERT(size <= mConfig.maxDrawDataSize, "draw data is larger than maxDrawDataSize");
+
+		RingAllocation allocation = mFrameData->allocate(size);
+		memcpy(allocation.data, data, size);
+		mCurrentDrawData = allocation.offset;
+	}
 
-		vkCmdDrawIndexed(mCmdBuffers[mCurrentFrame], (uint)ib.indexCount(), 1, 0, 0, 0);
+	void Renderer::beginRenderPass(VkSubpassContents contents) {
+		VkRenderPassBeginInfo passBeginInfo{};
+		passBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		passBeginInfo.renderPass = mRenderPass->vkHandle();
+		passBeginInfo.framebuffer = mFramebuffers[mImageIdx].vkHandle();
+		passBeginInfo.renderArea.extent = mTarget.extent();
+		passBeginInfo.renderArea.offset = { 0, 0 };
+
+		VkClearValue clearColor = { {{ 0.f, 0.f, 0.f, 1.f }} };
+		passBeginInfo.clearValueCount = 1;
+		passBeginInfo.pClearValues = &clearColor;
+
+		vkCmdBeginRenderPass(mCmdBuffers[mCurrentFrame], &passBeginInfo, contents);
+	}
+
+	void Renderer::setDynamicState(VkCommandBuffer cmd) {
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = (float)mViewportWidth;
+		viewport.height = (float)mViewportHeight;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+		VkRect2D scissor{};
+		scissor.offset = { 0, 0 };
+		scissor.extent = mTarget.extent();
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+	}
+
+	void Renderer::cullDrawList() {
+		const std::vector<DrawPacket>& packets = mDrawList.packets();
+
+		mCullSpheres.resize(packets.size());
+		for (size_t i = 0; i < packets.size(); i++) {
+			BoundingSphere sphere = packets[i].bounds.transformed(packets[i].model);
+			mCullSpheres[i] = glm::vec4(sphere.center, sphere.radius);
+		}
+
+		mVisibility.resize(packets.size());
+		size_t visibleCount = cullSpheres(Frustum::fromMatrix(mProjView), mCullSpheres, mVisibility.data());
+
+		if (visibleCount < packets.size()) {
+			mDrawList.retain(mVisibility);
+		}
+	}
+
+	void Renderer::recordDrawList() {
+		auto recordStart = std::chrono::steady_clock::now();
+
+		uint submissions = (uint)mDrawList.size();
+		if (mConfig.cpuCulling) {
+			cullDrawList();
+		}
+
+		mDrawList.sort();
+
+		// buffer of the current frame is not in use by the GPU since its fence was waited on in begin()
+		mInstanceBuffers[mCurrentFrame]->reserve(mDrawList.size());
+		if (mConfig.indirectDrawing) {
+			mIndirectBuffers[mCurrentFrame]->reserve(mDrawList.size());
+		}
+
+		if (mProfiler) {
+			mProfiler->beginPipelineStatistics(mCmdBuffers[mCurrentFrame], mCurrentFrame);
+		}
+
+		// the dispatch only runs after submission so the cull objects written
+		// while recording the packets below are already in place by then
+		if (mCullingPass) {
+			mCullingPass->reserve(mCurrentFrame, mDrawList.size());
+			mCullingPass->record(
+				mCmdBuffers[mCurrentFrame],
+				mCurrentFrame,
+				mProjView,
+				(uint)mDrawList.size(),
+				*mInstanceBuffers[mCurrentFrame],
+				*mIndirectBuffers[mCurrentFrame]
+			);
+		}
+
+		uint chunkCount = 1;
+		if (mRecordingPool) {
+			size_t chunksNeeded = (mDrawList.size() + mConfig.minPacketsPerThread - 1) / std::max(mConfig.minPacketsPerThread, 1u);
+			chunkCount = (uint)std::clamp<size_t>(chunksNeeded, 1, mRecordingPool->threadCount());
+		}
+
+		if (mProfiler) {
+			mProfiler->writeTimestamp(mCmdBuffers[mCurrentFrame], mCurrentFrame, GpuProfiler::RenderPassBegin, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		}
+
+		if (chunkCount > 1) {
+			beginRenderPass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			mStats = recordPacketsParallel(chunkCount);
+		}
+		else {
+			beginRenderPass(VK_SUBPASS_CONTENTS_INLINE);
+			setDynamicState(mCmdBuffers[mCurrentFrame]);
+
+			RecordContext ctx{};
+			ctx.cmd = mCmdBuffers[mCurrentFrame];
+			recordPackets(ctx, 0, mDrawList.size());
+			mStats = ctx.stats;
+		}
+
+		vkCmdEndRenderPass(mCmdBuffers[mCurrentFrame]);
+
+		if (mProfiler) {
+			mProfiler->writeTimestamp(mCmdBuffers[mCurrentFrame], mCurrentFrame, GpuProfiler::RenderPassEnd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+			mProfiler->endPipelineStatistics(mCmdBuffers[mCurrentFrame], mCurrentFrame);
+		}
+
+		mStats.submissions = submissions;
+		mStats.culledSubmissions = submissions - (uint)mDrawList.size();
+		mStats.skippedSubmissions = mSkippedSubmissions;
+		std::chrono::duration<float, std::milli> recordTime = std::chrono::steady_clock::now() - recordStart;
+		mStats.recordTimeMs = recordTime.count();
+	}
+
+	RendererStatistics Renderer::recordPacketsParallel(uint chunkCount) {
+		size_t chunkSize = (mDrawList.size() + chunkCount - 1) / chunkCount;
+
+		std::vector<std::future<RendererStatistics>> chunkResults;
+		chunkResults.reserve(chunkCount);
+
+		for (uint chunk = 0; chunk < chunkCount; chunk++) {
+			size_t first = chunk * chunkSize;
+			size_t last = std::min(first + chunkSize, mDrawList.size());
+
+			chunkResults.push_back(mRecordingPool->submit([this, chunk, first, last]() {
+				VkCommandBuffer cmd = mWorkerCmdBuffers[mCurrentFrame][chunk];
+				vkResetCommandPool(mDevice.vkDevice(), mWorkerCmdPools[mCurrentFrame][chunk], 0);
+
+				VkCommandBufferInheritanceInfo inheritanceInfo{};
+				inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+				inheritanceInfo.renderPass = mRenderPass->vkHandle();
+				inheritanceInfo.subpass = 0;
+				inheritanceInfo.framebuffer = mFramebuffers[mImageIdx].vkHandle();
+				inheritanceInfo.pipelineStatistics = mProfiler ? mProfiler->pipelineStatisticsFlags() : 0;
+
+				VkCommandBufferBeginInfo beginInfo{};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+				beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+				VkResult beginResult = vkBeginCommandBuffer(cmd, &beginInfo);
+				checkVkResult(beginResult, "failed to begin secondary command buffer");
+
+				// dynamic state and bindings are not inherited from the primary buffer
+				setDynamicState(cmd);
+
+				RecordContext ctx{};
+				ctx.cmd = cmd;
+				recordPackets(ctx, first, last);
+
+				VkResult endResult = vkEndCommandBuffer(cmd);
+				checkVkResult(endResult, "failed to record secondary command buffer");
+				return ctx.stats;
+			}));
+		}
+
+		RendererStatistics stats{};
+		for (auto& result : chunkResults) {
+			RendererStatistics chunkStats = result.get();
+			stats.drawCalls += chunkStats.drawCalls;
+			stats.pipelineBinds += chunkStats.pipelineBinds;
+			stats.bufferBinds += chunkStats.bufferBinds;
+			stats.indirectCommands += chunkStats.indirectCommands;
+			stats.triangles += chunkStats.triangles;
+		}
+
+		vkCmdExecuteCommands(mCmdBuffers[mCurrentFrame], chunkCount, mWorkerCmdBuffers[mCurrentFrame].data());
+		return stats;
+	}
+
+	void Renderer::recordPackets(RecordContext& ctx, size_t first, size_t last) {
+		size_t packetIdx = first;
+		while (packetIdx < last) {
+			uint scope = mDrawList[packetIdx].scope;
+			bool timed = mProfiler && scope != 0;
+
+			// a scope may span chunks recorded by different workers, the timestamps go
+			// wherever its first and last packet end up
+			if (timed && (packetIdx == 0 || mDrawList[packetIdx - 1].scope != scope)) {
+				mProfiler->beginScope(ctx.cmd, mCurrentFrame, scope);
+			}
+
+			size_t next = recordBatch(ctx, packetIdx, last);
+
+			if (timed && (next == mDrawList.size() || mDrawList[next].scope != scope)) {
+				mProfiler->endScope(ctx.cmd, mCurrentFrame, scope);
+			}
+			packetIdx = next;
+		}
+	}
+
+	// records the packets drawn together with the one at packetIdx, returns the index after them
+	size_t Renderer::recordBatch(RecordContext& ctx, size_t packetIdx, size_t last) {
+		InstanceBuffer& instanceBuffer = *mInstanceBuffers[mCurrentFrame];
+		const DrawPacket& packet = mDrawList[packetIdx];
+
+		if (packet.pipeline != ctx.boundPipeline) {
+			bindPipeline(ctx, packet.pipeline);
+		}
+
+		if (packet.drawData != ctx.boundDrawData) {
+			bindDescriptorSet(ctx, packet.drawData);
+		}
+
+		const DrawGeometry& geometry = packet.geometry;
+		if (geometry.vertexBuffer != ctx.boundVertexBuffer || geometry.indexBuffer != ctx.boundIndexBuffer) {
+			bindMeshBuffers(ctx, geometry);
+		}
+
+		if (!ctx.instancing) {
+			if (mCullingPass) {
+				mCullingPass->objects(mCurrentFrame)[packetIdx].command = CullObject::skip;
+			}
+			updateModelMatrix(ctx, packet.model);
+			vkCmdDrawIndexed(ctx.cmd, geometry.indexCount, 1, geometry.firstIndex, geometry.vertexOffset, 0);
+			ctx.stats.drawCalls++;
+			ctx.stats.triangles += geometry.indexCount / 3;
+			return packetIdx + 1;
+		}
+
+		if (!ctx.instanceBufferBound) {
+			VkBuffer instanceBuffers[] = { instanceBuffer.vkHandle() };
+			VkDeviceSize offsets[] = { 0 };
+			vkCmdBindVertexBuffers(ctx.cmd, InstanceData::binding, 1, instanceBuffers, offsets);
+			ctx.instanceBufferBound = true;
+		}
+
+		if (mConfig.indirectDrawing) {
+			return recordIndirectGroup(ctx, packetIdx, last);
+		}
+
+		size_t runEnd = writeInstanceRun(packetIdx, last);
+		vkCmdDrawIndexed(ctx.cmd, geometry.indexCount, (uint)(runEnd - packetIdx), geometry.firstIndex, geometry.vertexOffset, (uint)packetIdx);
+		ctx.stats.drawCalls++;
+		ctx.stats.triangles += (uint64)(geometry.indexCount / 3) * (runEnd - packetIdx);
+		return runEnd;
+	}
+
+	size_t Renderer::writeInstanceRun(size_t first, size_t last) {
+		InstanceData* instances = mInstanceBuffers[mCurrentFrame]->data();
+		const DrawPacket& packet = mDrawList[first];
+
+		// after sorting all submissions of one mesh with the same pipeline are adjacent,
+		// instance slots match packet indices so chunks recorded in parallel never overlap
+		size_t runEnd = first;
+		while (
+			runEnd < last &&
+			sameBatch(mDrawList[runEnd], packet)
+		) {
+			instances[runEnd].model = mDrawList[runEnd].model;
+			runEnd++;
+		}
+		return runEnd;
+	}
+
+	size_t Renderer::writeCullRun(size_t first, size_t last, uint command) {
+		CullObject* objects = mCullingPass->objects(mCurrentFrame);
+		const DrawPacket& packet = mDrawList[first];
+
+		size_t runEnd = first;
+		while (
+			runEnd < last &&
+			sameBatch(mDrawList[runEnd], packet)
+		) {
+			const DrawPacket& runPacket = mDrawList[runEnd];
+			objects[runEnd].model = runPacket.model;
+			objects[runEnd].sphere = glm::vec4(runPacket.bounds.center, runPacket.bounds.radius);
+			objects[runEnd].command = command;
+			runEnd++;
+		}
+		return runEnd;
+	}
+
+	size_t Renderer::recordIndirectGroup(RecordContext& ctx, size_t first, size_t last) {
+		IndirectBuffer& indirectBuffer = *mIndirectBuffers[mCurrentFrame];
+		VkDrawIndexedIndirectCommand* commands = indirectBuffer.commands();
+
+		const DrawPacket& packet = mDrawList[first];
+
+		// runs of one pipeline reading the same vertex and index buffers share a single draw call,
+		// which covers every mesh of a geometry pool,
+		// a group never writes more commands than it has packets so its slots start at its first packet
+		uint drawCount = 0;
+		size_t packetIdx = first;
+		while (
+			packetIdx < last &&
+			mDrawList[packetIdx].pipeline == packet.pipeline &&
+			mDrawList[packetIdx].scope == packet.scope &&
+			mDrawList[packetIdx].drawData == packet.drawData &&
+			mDrawList[packetIdx].geometry.vertexBuffer == packet.geometry.vertexBuffer &&
+			mDrawList[packetIdx].geometry.indexBuffer == packet.geometry.indexBuffer
+		) {
+			uint commandIdx = (uint)(first + drawCount);
+
+			// with gpu culling the run only reserves instance slots, the compute pass fills them and counts the visible ones
+			size_t runEnd = mCullingPass
+				? writeCullRun(packetIdx, last, commandIdx)
+				: writeInstanceRun(packetIdx, last);
+
+			const DrawGeometry& geometry = mDrawList[packetIdx].geometry;
+			VkDrawIndexedIndirectCommand& command = commands[commandIdx];
+			command.indexCount = geometry.indexCount;
+			command.instanceCount = mCullingPass ? 0 : (uint)(runEnd - packetIdx);
+			command.firstIndex = geometry.firstIndex;
+			command.vertexOffset = geometry.vertexOffset;
+			command.firstInstance = (uint)packetIdx;
+			ctx.stats.triangles += (uint64)(geometry.indexCount / 3) * (runEnd - packetIdx);
+
+			drawCount++;
+			packetIdx = runEnd;
+		}
+
+		VkDeviceSize offset = indirectBuffer.commandOffset(first);
+		uint stride = sizeof(VkDrawIndexedIndirectCommand);
+
+		if (mDevice.drawIndirectCountSupported()) {
+			indirectBuffer.counts()[first] = drawCount;
+			mDevice.cmdDrawIndexedIndirectCount(
+				ctx.cmd,
+				indirectBuffer.vkHandle(), offset,
+				indirectBuffer.vkHandle(), indirectBuffer.countOffset(first),
+				drawCount, stride
+			);
+			ctx.stats.drawCalls++;
+		}
+		else if (mDevice.features().multiDrawIndirect) {
+			vkCmdDrawIndexedIndirect(ctx.cmd, indirectBuffer.vkHandle(), offset, drawCount, stride);
+			ctx.stats.drawCalls++;
+		}
+		else {
+			for (uint i = 0; i < drawCount; i++) {
+				vkCmdDrawIndexedIndirect(ctx.cmd, indirectBuffer.vkHandle(), offset + i * stride, 1, stride);
+			}
+			ctx.stats.drawCalls += drawCount;
+		}
+
+		ctx.stats.indirectCommands += drawCount;
+		return packetIdx;
+	}
+
+	void Renderer::bindPipeline(RecordContext& ctx, uint pipelineId) {
+		const Pipeline& pipeline = *mPipelines[pipelineId];
+		vkCmdBindPipeline(ctx.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.vkHandle());
+
+		ctx.boundPipeline = pipelineId;
+		ctx.instancing = pipeline.configuration().instancingEnabled;
+		ctx.stats.pipelineBinds++;
+	}
+
+	void Renderer::bindDescriptorSet(RecordContext& ctx, uint drawData) {
+		// all pipelines share the same set layout so the set stays bound across pipeline changes
+		uint dynamicOffsets[] = { mFrameUniformOffset, drawData };
+		vkCmdBindDescriptorSets(
+			ctx.cmd,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			mPipelines[ctx.boundPipeline]->layout(),
+			0, 1,
+			&mDescriptorSet,
+			2, dynamicOffsets
+		);
+		ctx.boundDrawData = drawData;
+	}
+
+	void Renderer::bindMeshBuffers(RecordContext& ctx, const DrawGeometry& geometry) {
+		VkBuffer vertexBuffers[] = { geometry.vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(ctx.cmd, 0, 1, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(ctx.cmd, geometry.indexBuffer, 0, geometry.indexType);
+		ctx.boundVertexBuffer = geometry.vertexBuffer;
+		ctx.boundIndexBuffer = geometry.indexBuffer;
+		ctx.stats.bufferBinds++;
 	}
 
 	void Renderer::recreateSwapchain() {
 		mDevice.wait();
 
 		mFramebuffers.clear();
-		mSwapchain.destroy();
+		mTarget.destroy();
 
-		mSwapchain.create();
+		mTarget.create();
 		createFramebuffers();
 	}
 
-	void Renderer::updateModelMatrix(const glm::mat4& model) {
+	void Renderer::updateModelMatrix(RecordContext& ctx, const glm::mat4& model) {
 		vkCmdPushConstants(
-			mCmdBuffers[mCurrentFrame],
-			mPipelines[mCurrentPipeline.id]->layout(),
+			ctx.cmd,
+			mPipelines[ctx.boundPipeline]->layout(),
 			VK_SHADER_STAGE_VERTEX_BIT,
 			0, 
 			sizeof(model), &model
@@ -1,6 +1,7 @@
 #pragma once
 #include <Vulkan/Device.h>
 #include <Vulkan/Swapchain.h>
+#include <Vulkan/OffscreenTarget.h>
 #include <Events/EventHandler.h>
 #include "Pipeline.h"
 #include "Framebuffer.h"
@@ -8,7 +9,13 @@
 #include "Buffers.h"
 #include "Mesh.h"
 #include "Uniforms.h"
+#include "DrawList.h"
+#include "CullingPass.h"
+#include "Culling.h"
+#include "GpuProfiler.h"
+#include "FrameRingBuffer.h"
 #include <API/Transform.h>
+#include <Threading/ThreadPool.h>
 
 namespace cp {
 	struct PipelineHandle {
@@ -17,51 +24,195 @@ namespace cp {
 
 	struct RendererConfiguration {
 		uint framesInFlight = 2;
+
+		// draw list recording is split across this many worker threads into secondary command buffers
+		uint recordingThreads = 1;
+		// smaller draw lists are recorded by fewer workers, a single chunk is recorded inline
+		uint minPacketsPerThread = 1024;
+
+		// bytes of the per-frame ring buffer holding the frame uniforms and per-draw data
+		uint frameDataSize = 1 << 20;
+		// range of the per-draw uniform at binding 1, setDrawData can't write more than this
+		uint maxDrawDataSize = 256;
+
+		// instanced pipelines emit their draws from a per-frame indirect buffer,
+		// runs sharing vertex and index buffers collapse into one multi-draw call
+		bool indirectDrawing = false;
+
+		// objects of instanced pipelines are frustum culled by a compute pass writing the visible
+		// instances and their counts into the indirect commands, requires indirectDrawing
+		bool gpuCulling = false;
+		std::filesystem::path cullingShaderPath = gConstants.spirvDir / "cull.spv";
+
+		// submissions outside of the view frustum are dropped on the CPU before sorting
+		bool cpuCulling = false;
+
+		// meshes with a LOD chain draw their coarsest level whose error projects to at most this
+		// many pixels on screen, 0 always draws full detail
+		float lodErrorPixels = 1.f;
+
+		// timestamps around the frame, the render pass and user scopes, read back framesInFlight frames later,
+		// turned off when the graphics queue reports no valid timestamp bits
+		bool gpuProfiling = false;
+		// vertex/fragment/compute invocation counts of the frame, requires gpuProfiling
+		bool pipelineStatistics = false;
+		uint maxGpuScopes = 16;
+
+		// threads compiling pipelines for addPipelineConfigurations and addPipelineConfigurationAsync,
+		// 0 uses every hardware thread, fewer leave more of the CPU to frames recorded meanwhile
+		uint pipelineCompileThreads = 0;
+	};
+
+	// counters of the last recorded frame
+	struct RendererStatistics {
+		uint submissions = 0;
+		uint culledSubmissions = 0;
+		// dropped because their pipeline and its fallbacks were still compiling
+		uint skippedSubmissions = 0;
+		uint drawCalls = 0;
+		uint pipelineBinds = 0;
+		uint bufferBinds = 0;
+		uint indirectCommands = 0;
+		// recorded triangles after LOD selection and CPU culling, before GPU culling
+		uint64 triangles = 0;
+		float recordTimeMs = 0.f;
 	};
 
 	class Renderer {
 	public:
+		// with an OffscreenTarget frames are rendered round robin into its images and nothing is presented
 		Renderer(
 			Device& device,
-			Swapchain& swpachain,
+			RenderTarget& target,
 			EventHandler& evtHandler,
 			const RendererConfiguration& config = {}
 		);
 		~Renderer();
 
 		PipelineHandle addPipelineConfiguration(PipelineConfiguration& config);
+		// compiles the pipelines concurrently and returns once all of them are ready
+		std::vector<PipelineHandle> addPipelineConfigurations(std::span<PipelineConfiguration> configs);
+		// returns right away and compiles in the background, the handle can be used immediately.
+		// Until the pipeline is ready its meshes are drawn with the fallback, which has to take the
+		// same vertex layout, or skipped when there is none. Finished pipelines are picked up by begin,
+		// the shader is copied so it doesn't have to outlive the compilation
+		PipelineHandle addPipelineConfigurationAsync(PipelineConfiguration& config, PipelineHandle fallback = {});
+		bool pipelineReady(PipelineHandle handle) const { return handle.id < mPipelines.size() && mPipelines[handle.id]; }
+		size_t pendingPipelineCount() const { return mPendingPipelines.size(); }
 		void usePipeline(PipelineHandle handle);
 
 		void begin();
 		void end();
+		// the LOD is picked from the projected size of the mesh with the camera of setProjView
 		void submitMesh(const Mesh<PositionColorVertex>& mesh, const Transform& tf);
 		void submitMesh(const Mesh<SpriteVertex>& mesh, const Transform& tf);
+		// draws the current frame slot of the mesh, DynamicMesh::advance has to be called before
+		void submitMesh(const DynamicMesh<PositionColorVertex>& mesh, const Transform& tf);
+		void submitMesh(const DynamicMesh<SpriteVertex>& mesh, const Transform& tf);
+		// positions are dequantized through the model matrix, pipelines need a packed vertex type
+		void submitMesh(const Mesh<PackedPositionColorVertex>& mesh, const Transform& tf);
+		void submitMesh(const Mesh<PackedSpriteVertex>& mesh, const Transform& tf);
+		// meshes of one pool share vertex and index buffers, they are bound once and can be drawn by a single indirect call
+		void submitMesh(const PooledMesh<PositionColorVertex>& mesh, const Transform& tf);
+		void submitMesh(const PooledMesh<SpriteVertex>& mesh, const Transform& tf);
 
 		void setViewportSize(int width, int height);
 		void setProjView(const glm::mat4& projection, const glm::mat4& view);
 
+		// copies data into the frame ring buffer, meshes submitted afterwards read it from the
+		// uniform at binding 1 until it is set again, only valid between begin and end
+		void setDrawData(const void* data, size_t size);
+		template <class T>
+		void setDrawData(const T& data) { setDrawData(&data, sizeof(T)); }
+		// bytes of the frame ring buffer used by the current frame
+		size_t frameDataUsage() const { return mFrameData->used(); }
+
 		glm::vec2 viewportSize() const { return { mViewportWidth, mViewportHeight }; }
+		const RendererStatistics& statistics() const { return mStats; }
+
+		// submissions until endGpuScope are timed together on the GPU, scopes don't nest
+		// and have to be opened between begin and end
+		void beginGpuScope(std::string_view name);
+		void endGpuScope();
+		// latest resolved GPU timings, invalid until gpuProfiling has been on for framesInFlight frames
+		const GpuFrameTimings& gpuTimings() const;
+
+		// waits for the last submitted frame and copies its image, offscreen targets only
+		std::vector<uint8_t> readback();
 
 	private:
 		void init();
 		void createFramebuffers();
 		void createSyncObjects();
-		void createDescriptorSets();
+		void createDescriptorSets(uint pipelineId);
+
+		PipelineHandle reservePipeline(PipelineConfiguration& config, PipelineHandle fallback);
+		std::future<std::unique_ptr<Pipeline>> compilePipeline(const PipelineConfiguration& config);
+		void installPipeline(uint pipelineId, std::unique_ptr<Pipeline> pipeline);
+		void collectPipelines();
+		// the pipeline itself or the first of its fallbacks that is compiled, an invalid id if none is
+		uint drawablePipeline(uint pipelineId) const;
+
+		void createWorkerCommandBuffers();
 
-		void bindAndDrawBuffers(const VertexBuffer& vb, const IndexBuffer& ib);
-		void updateModelMatrix(const glm::mat4& model);
+		struct RecordContext {
+			VkCommandBuffer cmd = VK_NULL_HANDLE;
+			uint boundPipeline = PipelineHandle{}.id;
+			VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+			VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+			uint boundDrawData = (uint)(-1);
+			bool instancing = false;
+			bool instanceBufferBound = false;
+			RendererStatistics stats{};
+		};
+
+		void submitPacket(
+			uint meshId,
+			const DrawGeometry& geometry,
+			const BoundingSphere& bounds,
+			const Transform& tf,
+			const VertexQuantization& quantization = {},
+			std::span<const MeshLod> lods = {}
+		);
+		uint selectLod(std::span<const MeshLod> lods, const BoundingSphere& bounds, const glm::mat4& model) const;
+		void beginRenderPass(VkSubpassContents contents);
+		void setDynamicState(VkCommandBuffer cmd);
+		void cullDrawList();
+		void recordDrawList();
+		RendererStatistics recordPacketsParallel(uint chunkCount);
+		void recordPackets(RecordContext& ctx, size_t first, size_t last);
+		size_t recordBatch(RecordContext& ctx, size_t packetIdx, size_t last);
+		size_t writeInstanceRun(size_t first, size_t last);
+		size_t writeCullRun(size_t first, size_t last, uint command);
+		size_t recordIndirectGroup(RecordContext& ctx, size_t first, size_t last);
+		void bindPipeline(RecordContext& ctx, uint pipelineId);
+		void bindDescriptorSet(RecordContext& ctx, uint drawData);
+		void bindMeshBuffers(RecordContext& ctx, const DrawGeometry& geometry);
+		void updateModelMatrix(RecordContext& ctx, const glm::mat4& model);
 		void recreateSwapchain();
+		void present(VkSemaphore waitSemaphore);
 
 	private:
 		RendererConfiguration mConfig;
+		// null while the pipeline is compiling, its configuration is available from the start
 		std::vector<std::unique_ptr<Pipeline>> mPipelines;
+		std::vector<PipelineConfiguration> mPipelineConfigs;
+		std::vector<uint> mPipelineFallbacks;
 		PipelineHandle mCurrentPipeline{};
 
+		struct PendingPipeline {
+			uint id;
+			std::future<std::unique_ptr<Pipeline>> pipeline;
+		};
+		std::vector<PendingPipeline> mPendingPipelines;
+		std::unique_ptr<ThreadPool> mCompilePool;
+		uint mSkippedSubmissions = 0;
+
 		std::unique_ptr<RenderPass> mRenderPass;
 		std::vector<Framebuffer> mFramebuffers;
 		
 		Device& mDevice;
-		Swapchain& mSwapchain;
+		RenderTarget& mTarget;
 		
 		VkCommandPool mCmdPool;
 		VkDescriptorPool mDescriptorPool;
@@ -71,11 +222,33 @@ namespace cp {
 		std::vector<VkSemaphore> mRenderFinishedSemaphores;
 		std::vector<VkFence> mInFlightFences;
 
-		std::vector<VkDescriptorSet> mDescriptorSets;
-		std::vector<std::unique_ptr<UniformBuffer<ProjViewUBO>>> mMatrixUniformBuffers;
+		std::unique_ptr<ThreadPool> mRecordingPool;
+		std::vector<std::vector<VkCommandPool>> mWorkerCmdPools;
+		std::vector<std::vector<VkCommandBuffer>> mWorkerCmdBuffers;
+
+		// dynamic offsets select the frame's uniforms so a single set serves every frame in flight
+		VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+		std::unique_ptr<FrameRingBuffer> mFrameData;
+		uint mFrameUniformOffset = 0;
+		uint mCurrentDrawData = 0;
+		bool mRecording = false;
+		std::vector<std::unique_ptr<InstanceBuffer>> mInstanceBuffers;
+		std::vector<std::unique_ptr<IndirectBuffer>> mIndirectBuffers;
+		std::unique_ptr<CullingPass> mCullingPass;
+		std::unique_ptr<GpuProfiler> mProfiler;
+		uint mCurrentScope = 0;
+
+		DrawList mDrawList;
+		std::vector<glm::vec4> mCullSpheres;
+		std::vector<uint8_t> mVisibility;
+		RendererStatistics mStats{};
+		glm::mat4 mProjection{1.f};
+		glm::mat4 mView{1.f};
+		glm::mat4 mProjView{1.f};
 
 		int mViewportWidth, mViewportHeight;
 		uint mCurrentFrame = 0;
 		uint mImageIdx = 0;
+		uint mLastFrame = 0;
 	};
 }
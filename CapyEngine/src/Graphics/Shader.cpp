@@ -2,32 +2,13 @@
 #include <Application.h>
 
 namespace cp {
-	Shader::Shader(const std::filesystem::path& vertexShaderPath, const std::filesystem::path& fragmentShaderPath)
-		: mDevice(Application::get().device()) {
+	Shader::Shader(const std::filesystem::path& vertexShaderPath, const std::filesystem::path& fragmentShaderPath) {
+		Device& device = Application::get().device();
 
-		mVshData = readFileBin(vertexShaderPath);
-		mFshData = readFileBin(fragmentShaderPath);
+		mVertexModule = ShaderLibrary::load(device, vertexShaderPath);
+		mFragmentModule = ShaderLibrary::load(device, fragmentShaderPath);
 
-		vertexShaderModule = createShaderModule(mVshData);
-		fragmentShaderModule = createShaderModule(mFshData);
-	}
-
-	Shader::~Shader() {
-		vkDestroyShaderModule(mDevice.vkDevice(), vertexShaderModule, nullptr);
-		vkDestroyShaderModule(mDevice.vkDevice(), fragmentShaderModule, nullptr);
-		CP_DEBUG_LOG("shader modules destroyed");
-	}
-
-	VkShaderModule Shader::createShaderModule(const std::vector<char>& data) {
-		VkShaderModule shader = VK_NULL_HANDLE;
-
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = data.size();
-		createInfo.pCode = reinterpret_cast<const uint*>(data.data());
-
-		VkResult result = vkCreateShaderModule(mDevice.vkDevice(), &createInfo, nullptr, &shader);
-		checkVkResult(result, "couldnt compile shader module");
-		return shader;
+		vertexShaderModule = mVertexModule->vkHandle();
+		fragmentShaderModule = mFragmentModule->vkHandle();
 	}
 }
@@ -1,22 +1,20 @@
 #pragma once
 #include <Utils.h>
 #include <Vulkan/Device.h>
+#include "ShaderLibrary.h"
 
 namespace cp {
+	// vertex and fragment modules from the ShaderLibrary, Shaders loading the same SPIR-V share them.
+	// No bytecode is kept, the Shader can be destroyed once the pipelines using it are created
 	class Shader {
 	public:
 		Shader(const std::filesystem::path& vertexShaderPath, const std::filesystem::path& fragmentShaderPath);
-		~Shader();
 
 		VkShaderModule vertexShaderModule;
 		VkShaderModule fragmentShaderModule;
 
 	private:
-		VkShaderModule createShaderModule(const std::vector<char>& data);
-
-	private:
-		Device& mDevice;
-		std::vector<char> mVshData;
-		std::vector<char> mFshData;
+		std::shared_ptr<const ShaderModule> mVertexModule;
+		std::shared_ptr<const ShaderModule> mFragmentModule;
 	};
 }
@@ -0,0 +1,78 @@
+#include "ShaderLibrary.h"
+
+namespace cp {
+	static constexpr uint sSpirvMagic = 0x07230203;
+
+	std::mutex ShaderLibrary::sMutex;
+	std::unordered_map<std::string, ShaderLibrary::FileEntry> ShaderLibrary::sFiles;
+	std::unordered_map<uint64, std::weak_ptr<const ShaderModule>> ShaderLibrary::sModules;
+	ShaderLibraryStatistics ShaderLibrary::sStats{};
+
+	ShaderModule::ShaderModule(Device& device, std::span<const uint8_t> code, uint64 hash)
+		: mDevice(device), mHash(hash), mCodeSize(code.size()) {
+
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = code.size();
+		createInfo.pCode = reinterpret_cast<const uint*>(code.data());
+
+		VkResult result = vkCreateShaderModule(mDevice.vkDevice(), &createInfo, nullptr, &mModule);
+		checkVkResult(result, "couldnt compile shader module");
+	}
+
+	ShaderModule::~ShaderModule() {
+		vkDestroyShaderModule(mDevice.vkDevice(), mModule, nullptr);
+		CP_DEBUG_LOG("shader module destroyed");
+	}
+
+	std::shared_ptr<const ShaderModule> ShaderLibrary::load(Device& device, const std::filesystem::path& path) {
+		std::string key = std::filesystem::absolute(path).lexically_normal().string();
+
+		std::error_code error;
+		uintmax_t size = std::filesystem::file_size(path, error);
+		std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+		if (error) {
+			throw std::runtime_error("couldnt open file from path '" + path.string() + "'");
+		}
+
+		std::lock_guard lock(sMutex);
+		sStats.loads++;
+
+		// an unchanged file with a live module isn't touched at all
+		auto file = sFiles.find(key);
+		if (file != sFiles.end() && file->second.size == size && file->second.writeTime == writeTime) {
+			if (std::shared_ptr<const ShaderModule> module = sModules[file->second.hash].lock()) {
+				sStats.modulesShared++;
+				return module;
+			}
+		}
+
+		MappedFile mapped(path);
+		sStats.filesMapped++;
+
+		// the mapping is page aligned, pCode can point straight into it
+		if (mapped.size() < sizeof(uint) || mapped.size() % sizeof(uint) != 0 || *reinterpret_cast<const uint*>(mapped.data()) != sSpirvMagic) {
+			throw std::runtime_error("'" + path.string() + "' is not a SPIR-V binary");
+		}
+
+		uint64 hash = hashBytes(mapped.data(), mapped.size());
+		sFiles[key] = { size, writeTime, hash };
+
+		std::weak_ptr<const ShaderModule>& cached = sModules[hash];
+		std::shared_ptr<const ShaderModule> module = cached.lock();
+		if (module && module->codeSize() == mapped.size()) {
+			sStats.modulesShared++;
+			return module;
+		}
+
+		module = std::make_shared<const ShaderModule>(device, std::span<const uint8_t>(mapped.data(), mapped.size()), hash);
+		cached = module;
+		sStats.modulesCreated++;
+		return module;
+	}
+
+	ShaderLibraryStatistics ShaderLibrary::statistics() {
+		std::lock_guard lock(sMutex);
+		return sStats;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <Utils.h>
+#include <Vulkan/Device.h>
+
+namespace cp {
+	// a VkShaderModule and the hash of the SPIR-V it was created from, destroyed with its last user
+	class ShaderModule {
+	public:
+		ShaderModule(Device& device, std::span<const uint8_t> code, uint64 hash);
+		~ShaderModule();
+
+		ShaderModule(const ShaderModule&) = delete;
+		ShaderModule& operator=(const ShaderModule&) = delete;
+
+		VkShaderModule vkHandle() const { return mModule; }
+		uint64 hash() const { return mHash; }
+		size_t codeSize() const { return mCodeSize; }
+
+	private:
+		Device& mDevice;
+		VkShaderModule mModule = VK_NULL_HANDLE;
+		uint64 mHash = 0;
+		size_t mCodeSize = 0;
+	};
+
+	struct ShaderLibraryStatistics {
+		uint loads = 0;
+		// loads that had to map and hash the file, the rest matched an unchanged path
+		uint filesMapped = 0;
+		uint modulesCreated = 0;
+		// loads served by a live module, through its path or identical bytecode under another path
+		uint modulesShared = 0;
+	};
+
+	// Shares one VkShaderModule between every user of the same SPIR-V. Files are memory mapped and
+	// hashed, the mapping is released as soon as the module exists so no bytecode stays resident.
+	// Only weak references are kept, a module is destroyed once the Shaders and pipelines being
+	// created with it let go of it.
+	class ShaderLibrary {
+	public:
+		// throws std::runtime_error when the file can't be read or isn't SPIR-V
+		static std::shared_ptr<const ShaderModule> load(Device& device, const std::filesystem::path& path);
+
+		static ShaderLibraryStatistics statistics();
+
+	private:
+		// a path whose size and write time didn't change still holds the same bytecode
+		struct FileEntry {
+			uintmax_t size = 0;
+			std::filesystem::file_time_type writeTime{};
+			uint64 hash = 0;
+		};
+
+		static std::mutex sMutex;
+		static std::unordered_map<std::string, FileEntry> sFiles;
+		static std::unordered_map<uint64, std::weak_ptr<const ShaderModule>> sModules;
+		static ShaderLibraryStatistics sStats;
+	};
+}
@@ -58,11 +58,162 @@ namespace cp {
 			descs[1].offset = offsetof(SpriteVertex, color);
 
 			descs[2].binding = 0;
-			descs[2].location = 1;
+			descs[2].location = 2;
 			descs[2].format = VK_FORMAT_R32G32_SFLOAT;
 			descs[2].offset = offsetof(SpriteVertex, texCoord);
 
 			return descs;
 		}
 	};
+
+	// Maps mesh positions to the snorm16 range of packed vertices. The scale is uniform so the
+	// dequantization can be folded into the model matrix and bounding spheres stay spheres.
+	struct VertexQuantization {
+		glm::vec3 offset{0.f};
+		float scale = 1.f;
+
+		static VertexQuantization fromBounds(const glm::vec3& min, const glm::vec3& max) {
+			glm::vec3 extents = (max - min) * 0.5f;
+			float largest = std::max({ extents.x, extents.y, extents.z });
+			return { (min + max) * 0.5f, largest > 0.f ? largest : 1.f };
+		}
+
+		bool identity() const { return offset == glm::vec3(0.f) && scale == 1.f; }
+		// packed space to mesh space
+		glm::mat4 matrix() const { return glm::scale(glm::translate(glm::mat4(1.f), offset), glm::vec3(scale)); }
+
+		std::array<int16, 4> quantize(const glm::vec3& position) const {
+			glm::vec3 normalized = glm::clamp((position - offset) / scale, -1.f, 1.f);
+			return { snorm16(normalized.x), snorm16(normalized.y), snorm16(normalized.z), 0 };
+		}
+
+		glm::vec3 dequantize(const std::array<int16, 4>& position) const {
+			glm::vec3 normalized = glm::max(glm::vec3(position[0], position[1], position[2]) / 32767.f, glm::vec3(-1.f));
+			return offset + normalized * scale;
+		}
+
+		static int16 snorm16(float value) { return (int16)std::round(value * 32767.f); }
+	};
+
+	inline std::array<uint8_t, 4> packUnorm8(const glm::vec4& value) {
+		glm::vec4 scaled = glm::round(glm::clamp(value, 0.f, 1.f) * 255.f);
+		return { (uint8_t)scaled.x, (uint8_t)scaled.y, (uint8_t)scaled.z, (uint8_t)scaled.w };
+	}
+
+	// PositionColorVertex in 12 instead of 28 bytes, the shader inputs stay vec3/vec4
+	struct PackedPositionColorVertex {
+		std::array<int16, 4> position; // snorm16, w is padding
+		std::array<uint8_t, 4> color; // unorm8
+
+		static PackedPositionColorVertex pack(const PositionColorVertex& vertex, const VertexQuantization& quantization) {
+			return { quantization.quantize(vertex.position), packUnorm8(vertex.color) };
+		}
+
+		static VkVertexInputBindingDescription bindingDescription() {
+			VkVertexInputBindingDescription desc{};
+			desc.binding = 0;
+			desc.stride = sizeof(PackedPositionColorVertex);
+			desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			return desc;
+		}
+
+		// three component 16 bit formats are rarely supported as vertex input, the position uses four
+		static AttributeDescriptions attributeDescriptions() {
+			AttributeDescriptions descs(2);
+			descs[0].binding = 0;
+			descs[0].location = 0;
+			descs[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+			descs[0].offset = offsetof(PackedPositionColorVertex, position);
+
+			descs[1].binding = 0;
+			descs[1].location = 1;
+			descs[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+			descs[1].offset = offsetof(PackedPositionColorVertex, color);
+
+			return descs;
+		}
+	};
+
+	// SpriteVertex in 16 instead of 36 bytes, texture coordinates are clamped to [0, 1]
+	struct PackedSpriteVertex {
+		std::array<int16, 4> position; // snorm16, w is padding
+		std::array<uint8_t, 4> color; // unorm8
+		std::array<uint16, 2> texCoord; // unorm16
+
+		static PackedSpriteVertex pack(const SpriteVertex& vertex, const VertexQuantization& quantization) {
+			glm::vec2 texCoord = glm::round(glm::clamp(vertex.texCoord, 0.f, 1.f) * 65535.f);
+			return { quantization.quantize(vertex.position), packUnorm8(vertex.color), { (uint16)texCoord.x, (uint16)texCoord.y } };
+		}
+
+		static VkVertexInputBindingDescription bindingDescription() {
+			VkVertexInputBindingDescription desc{};
+			desc.binding = 0;
+			desc.stride = sizeof(PackedSpriteVertex);
+			desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			return desc;
+		}
+
+		static AttributeDescriptions attributeDescriptions() {
+			AttributeDescriptions descs(3);
+			descs[0].binding = 0;
+			descs[0].location = 0;
+			descs[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+			descs[0].offset = offsetof(PackedSpriteVertex, position);
+
+			descs[1].binding = 0;
+			descs[1].location = 1;
+			descs[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+			descs[1].offset = offsetof(PackedSpriteVertex, color);
+
+			descs[2].binding = 0;
+			descs[2].location = 2;
+			descs[2].format = VK_FORMAT_R16G16_UNORM;
+			descs[2].offset = offsetof(PackedSpriteVertex, texCoord);
+
+			return descs;
+		}
+	};
+
+	// mesh space position of a vertex, packed vertices need the quantization of their mesh
+	inline glm::vec3 vertexPosition(const PositionColorVertex& vertex, const VertexQuantization&) { return vertex.position; }
+	inline glm::vec3 vertexPosition(const SpriteVertex& vertex, const VertexQuantization&) { return vertex.position; }
+	inline glm::vec3 vertexPosition(const PackedPositionColorVertex& vertex, const VertexQuantization& quantization) { return quantization.dequantize(vertex.position); }
+	inline glm::vec3 vertexPosition(const PackedSpriteVertex& vertex, const VertexQuantization& quantization) { return quantization.dequantize(vertex.position); }
+
+	template <class VertexT>
+	std::vector<glm::vec3> vertexPositions(std::span<const VertexT> vertices, const VertexQuantization& quantization = {}) {
+		std::vector<glm::vec3> positions;
+		positions.reserve(vertices.size());
+		for (const VertexT& vertex : vertices) {
+			positions.push_back(vertexPosition(vertex, quantization));
+		}
+		return positions;
+	}
+
+	struct InstanceData {
+		glm::mat4 model;
+
+		static constexpr uint binding = 1;
+		static constexpr uint firstLocation = 4;
+
+		static VkVertexInputBindingDescription bindingDescription() {
+			VkVertexInputBindingDescription desc{};
+			desc.binding = binding;
+			desc.stride = sizeof(InstanceData);
+			desc.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+			return desc;
+		}
+
+		// mat4 takes up four consecutive vec4 locations
+		static AttributeDescriptions attributeDescriptions() {
+			AttributeDescriptions descs(4);
+			for (uint i = 0; i < 4; i++) {
+				descs[i].binding = binding;
+				descs[i].location = firstLocation + i;
+				descs[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+				descs[i].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * i;
+			}
+			return descs;
+		}
+	};
 }
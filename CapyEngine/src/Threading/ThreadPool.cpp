@@ -0,0 +1,39 @@
+#include "ThreadPool.h"
+
+namespace cp {
+	ThreadPool::ThreadPool(uint threadCount) {
+		CP_ASSERT(threadCount > 0, "thread pool needs at least one thread");
+		mThreads.reserve(threadCount);
+		for (uint i = 0; i < threadCount; i++) {
+			mThreads.emplace_back(&ThreadPool::workerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard lock(mMutex);
+			mStopping = true;
+		}
+		mCondition.notify_all();
+
+		for (std::thread& thread : mThreads) {
+			thread.join();
+		}
+	}
+
+	void ThreadPool::workerLoop() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock(mMutex);
+				mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+
+				if (mStopping && mTasks.empty()) return;
+
+				task = std::move(mTasks.front());
+				mTasks.pop();
+			}
+			task();
+		}
+	}
+}
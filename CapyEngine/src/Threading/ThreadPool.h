@@ -0,0 +1,44 @@
+#pragma once
+#include <include.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <queue>
+
+namespace cp {
+	class ThreadPool {
+	public:
+		ThreadPool(uint threadCount = std::max(std::thread::hardware_concurrency(), 1u));
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		template <class F>
+		std::future<std::invoke_result_t<F>> submit(F&& task) {
+			using ResultT = std::invoke_result_t<F>;
+			// std::function needs a copyable callable, packaged_task is move only
+			auto packagedTask = std::make_shared<std::packaged_task<ResultT()>>(std::forward<F>(task));
+			std::future<ResultT> future = packagedTask->get_future();
+			{
+				std::lock_guard lock(mMutex);
+				mTasks.emplace([packagedTask]() { (*packagedTask)(); });
+			}
+			mCondition.notify_one();
+			return future;
+		}
+
+		uint threadCount() const { return (uint)mThreads.size(); }
+
+	private:
+		void workerLoop();
+
+	private:
+		std::vector<std::thread> mThreads;
+		std::queue<std::function<void()>> mTasks;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		bool mStopping = false;
+	};
+}
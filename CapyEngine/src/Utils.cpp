@@ -1,5 +1,12 @@
 #include "Utils.h"
 
+#ifndef _MSC_VER
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 namespace cp {
 	const char* debugSeverityPrefix(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
 		switch (severity) {
@@ -48,6 +55,72 @@ namespace cp {
 		return bytes;
 	}
 
+	uint64 hashBytes(const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64 hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef _MSC_VER
+		mFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("couldnt open file from path '" + path.string() + "'");
+		}
+
+		LARGE_INTEGER fileSize{};
+		GetFileSizeEx(mFile, &fileSize);
+		mSize = (size_t)fileSize.QuadPart;
+		if (mSize == 0) return;
+
+		mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		mData = mMapping ? static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		if (!mData) {
+			if (mMapping) CloseHandle(mMapping);
+			CloseHandle(mFile);
+			throw std::runtime_error("failed to map file '" + path.string() + "'");
+		}
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("couldnt open file from path '" + path.string() + "'");
+		}
+
+		struct stat fileStat{};
+		fstat(fd, &fileStat);
+		mSize = (size_t)fileStat.st_size;
+		if (mSize == 0) {
+			close(fd);
+			return;
+		}
+
+		// the mapping keeps its own reference to the file
+		void* mapped = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED) {
+			throw std::runtime_error("failed to map file '" + path.string() + "'");
+		}
+
+		// read front to back, let the kernel read ahead
+		madvise(mapped, mSize, MADV_SEQUENTIAL);
+		madvise(mapped, mSize, MADV_WILLNEED);
+		mData = static_cast<const uint8_t*>(mapped);
+#endif
+	}
+
+	MappedFile::~MappedFile() {
+#ifdef _MSC_VER
+		if (mData) UnmapViewOfFile(mData);
+		if (mMapping) CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE) CloseHandle(mFile);
+#else
+		if (mData) munmap(const_cast<uint8_t*>(mData), mSize);
+#endif
+	}
+
 	void checkVkResult(VkResult result, std::string_view errorMessage) {
 		if (result != VK_SUCCESS) {
 			throw std::runtime_error(errorMessage.data());
@@ -8,6 +8,30 @@ namespace cp {
 
 	std::vector<char> readFileBin(const std::filesystem::path& path);
 
+	// 64 bit FNV-1a, for content keys and checksums, not for hash tables of small keys
+	uint64 hashBytes(const void* data, size_t size);
+
+	// read only mapping of a whole file, pages are read in by the OS on first access
+	class MappedFile {
+	public:
+		explicit MappedFile(const std::filesystem::path& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* data() const { return mData; }
+		size_t size() const { return mSize; }
+
+	private:
+		const uint8_t* mData = nullptr;
+		size_t mSize = 0;
+#ifdef _MSC_VER
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+#endif
+	};
+
 	void checkVkResult(VkResult result, std::string_view errorMessage);
 	void checkVkResult(const std::initializer_list<VkResult>& results, std::string_view errorMessage);
 }
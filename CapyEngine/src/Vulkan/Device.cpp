@@ -1,7 +1,26 @@
 #include "Device.h"
+#include "MemoryAllocator.h"
 
 namespace cp {
-	Device::Device(VkInstance instance, VkSurfaceKHR surface) : mInstance(instance), mSurface(surface) {
+	// written in front of the driver's cache data, the driver validates its own header as well but
+	// some implementations crash on data from an older driver instead of rejecting it
+	struct PipelineCacheFileHeader {
+		static constexpr uint magicValue = 0x43505043; // "CPPC"
+		static constexpr uint currentVersion = 1;
+
+		uint magic = magicValue;
+		uint version = currentVersion;
+		uint vendorID = 0;
+		uint deviceID = 0;
+		uint driverVersion = 0;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE]{};
+		uint64 dataSize = 0;
+		// catches files cut short or corrupted by a crash during the save
+		uint64 checksum = 0;
+	};
+
+	Device::Device(VkInstance instance, VkSurfaceKHR surface, const std::filesystem::path& pipelineCachePath)
+		: mInstance(instance), mSurface(surface), mPipelineCachePath(pipelineCachePath) {
 		uint deviceCount = 0;
 		vkEnumeratePhysicalDevices(mInstance, &deviceCount, nullptr);
 
@@ -13,8 +32,8 @@ namespace cp {
 		vkEnumeratePhysicalDevices(mInstance, &deviceCount, devicesAvail.data());
 
 		setSuitableDevice(devicesAvail);
-		VkPhysicalDeviceFeatures features;
-		vkGetPhysicalDeviceFeatures(physicalDevice_, &features);
+		vkGetPhysicalDeviceFeatures(physicalDevice_, &mFeatures);
+		vkGetPhysicalDeviceProperties(physicalDevice_, &mProperties);
 
 		QueueFamilyIndices indicies = findQueueFamilies(physicalDevice_);
 
@@ -23,6 +42,9 @@ namespace cp {
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
 		std::unordered_set<uint> queueFamilies = { indicies.graphicsFamily.value(), indicies.presentFamily.value() };
+		if (indicies.transferFamily.has_value()) {
+			queueFamilies.insert(indicies.transferFamily.value());
+		}
 		for (uint family : queueFamilies) {
 			VkDeviceQueueCreateInfo queueCreateInfo{};
 			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -36,27 +58,187 @@ namespace cp {
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.queueCreateInfoCount = (uint)queueCreateInfos.size();
-		createInfo.pEnabledFeatures = &features;
+		createInfo.pEnabledFeatures = &mFeatures;
+
+		std::vector<const char*> extensions;
+		if (!headless()) {
+			extensions.insert(extensions.end(), mDeviceExtensions.begin(), mDeviceExtensions.end());
+		}
+		for (const char* extension : mOptionalDeviceExtensions) {
+			if (extensionSupported(physicalDevice_, extension)) {
+				extensions.push_back(extension);
+			}
+		}
 
-		createInfo.enabledExtensionCount = (uint)mDeviceExtensions.size();
-		createInfo.ppEnabledExtensionNames = mDeviceExtensions.data();
+		createInfo.enabledExtensionCount = (uint)extensions.size();
+		createInfo.ppEnabledExtensionNames = extensions.data();
 		createInfo.enabledLayerCount = 0;
 
 		VkResult result = vkCreateDevice(physicalDevice_, &createInfo, nullptr, &mDevice);
 		checkVkResult(result, "failed to create Vulkan logical device");
 
-		vkGetDeviceQueue(mDevice, indicies.graphicsFamily.value(), 0, &mGraphicsQueue);
+		mGraphicsFamily = indicies.graphicsFamily.value();
+		vkGetDeviceQueue(mDevice, mGraphicsFamily, 0, &mGraphicsQueue);
+
+		uint queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice_, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> familyProperties(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice_, &queueFamilyCount, familyProperties.data());
+		mTimestampValidBits = familyProperties[mGraphicsFamily].timestampValidBits;
+
+		mTransferFamily = indicies.transferFamily.value_or(mGraphicsFamily);
+		vkGetDeviceQueue(mDevice, mTransferFamily, 0, &mTransferQueue);
+
+		if (extensionSupported(physicalDevice_, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+			mCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(mDevice, "vkCmdDrawIndexedIndirectCountKHR");
+		}
+
+		mAllocator = std::make_unique<MemoryAllocator>(*this);
+		createPipelineCache();
 	}
 
 	Device::~Device() {
+		savePipelineCache();
+		vkDestroyPipelineCache(mDevice, mPipelineCache, nullptr);
+		mAllocator.reset();
 		vkDestroyDevice(mDevice, nullptr);
 		CP_DEBUG_LOG("device destroyed");
 	}
 
+	void Device::createPipelineCache() {
+		std::vector<char> data = loadPipelineCacheData();
+
+		VkPipelineCacheCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		VkResult result = vkCreatePipelineCache(mDevice, &createInfo, nullptr, &mPipelineCache);
+		if (result != VK_SUCCESS && !data.empty()) {
+			// data the driver refuses is dropped, the cache starts out empty instead
+			CP_DEBUG_LOG("pipeline cache '%s' rejected by the driver", mPipelineCachePath.string().c_str());
+			createInfo.initialDataSize = 0;
+			createInfo.pInitialData = nullptr;
+			result = vkCreatePipelineCache(mDevice, &createInfo, nullptr, &mPipelineCache);
+		}
+		checkVkResult(result, "failed to create a pipeline cache");
+	}
+
+	std::vector<char> Device::loadPipelineCacheData() const {
+		std::error_code error;
+		if (mPipelineCachePath.empty() || !std::filesystem::exists(mPipelineCachePath, error)) return {};
+
+		std::vector<char> file;
+		try {
+			file = readFileBin(mPipelineCachePath);
+		}
+		catch (const std::runtime_error&) {
+			CP_DEBUG_LOG("couldn't read pipeline cache '%s'", mPipelineCachePath.string().c_str());
+			return {};
+		}
+
+		auto discard = [&](const char* reason) {
+			CP_DEBUG_LOG("discarding pipeline cache '%s': %s", mPipelineCachePath.string().c_str(), reason);
+			return std::vector<char>{};
+		};
+
+		PipelineCacheFileHeader header;
+		if (file.size() < sizeof(header)) return discard("too small for a header");
+		memcpy(&header, file.data(), sizeof(header));
+
+		if (header.magic != PipelineCacheFileHeader::magicValue || header.version != PipelineCacheFileHeader::currentVersion) return discard("unknown format");
+		if (header.vendorID != mProperties.vendorID || header.deviceID != mProperties.deviceID) return discard("written by another device");
+		if (header.driverVersion != mProperties.driverVersion || memcmp(header.pipelineCacheUUID, mProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+			return discard("written by another driver version");
+		}
+		if (header.dataSize != file.size() - sizeof(header)) return discard("truncated");
+
+		const char* data = file.data() + sizeof(header);
+		if (header.checksum != hashBytes(data, (size_t)header.dataSize)) return discard("checksum mismatch");
+
+		// the driver's own header must agree as well
+		VkPipelineCacheHeaderVersionOne driverHeader{};
+		if (header.dataSize < sizeof(driverHeader)) return discard("no driver header");
+		memcpy(&driverHeader, data, sizeof(driverHeader));
+		if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+			driverHeader.vendorID != mProperties.vendorID ||
+			driverHeader.deviceID != mProperties.deviceID ||
+			memcmp(driverHeader.pipelineCacheUUID, mProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+			return discard("driver header mismatch");
+		}
+
+		CP_DEBUG_LOG("loaded pipeline cache '%s' (%zu bytes)", mPipelineCachePath.string().c_str(), (size_t)header.dataSize);
+		return std::vector<char>(data, data + header.dataSize);
+	}
+
+	void Device::savePipelineCache() const {
+		if (mPipelineCachePath.empty() || mPipelineCache == VK_NULL_HANDLE) return;
+
+		size_t size = 0;
+		if (vkGetPipelineCacheData(mDevice, mPipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) return;
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(mDevice, mPipelineCache, &size, data.data()) != VK_SUCCESS) return;
+		data.resize(size);
+
+		PipelineCacheFileHeader header;
+		header.vendorID = mProperties.vendorID;
+		header.deviceID = mProperties.deviceID;
+		header.driverVersion = mProperties.driverVersion;
+		memcpy(header.pipelineCacheUUID, mProperties.pipelineCacheUUID, VK_UUID_SIZE);
+		header.dataSize = data.size();
+		header.checksum = hashBytes(data.data(), data.size());
+
+		// written next to the old file and swapped in, a crash mid-write leaves the previous cache intact
+		std::filesystem::path tempPath = mPipelineCachePath;
+		tempPath += ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), (std::streamsize)data.size());
+			if (!file) {
+				CP_DEBUG_LOG("couldn't write pipeline cache '%s'", tempPath.string().c_str());
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, mPipelineCachePath, error);
+		if (error) {
+			CP_DEBUG_LOG("couldn't replace pipeline cache '%s': %s", mPipelineCachePath.string().c_str(), error.message().c_str());
+			std::filesystem::remove(tempPath, error);
+			return;
+		}
+		CP_DEBUG_LOG("saved pipeline cache '%s' (%zu bytes)", mPipelineCachePath.string().c_str(), data.size());
+	}
+
 	void Device::wait() const {
 		vkDeviceWaitIdle(mDevice);
 	}
 
+	void Device::cmdDrawIndexedIndirectCount(
+		VkCommandBuffer cmd,
+		VkBuffer buffer, VkDeviceSize offset,
+		VkBuffer countBuffer, VkDeviceSize countOffset,
+		uint maxDrawCount, uint stride
+	) const {
+		CP_ASSERT(drawIndirectCountSupported(), "VK_KHR_draw_indirect_count is not supported by the device");
+		mCmdDrawIndexedIndirectCount(cmd, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+	}
+
+	VkMemoryPropertyFlags Device::staticMemoryProperties() const {
+		VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		if (!unifiedMemory()) return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+		VkPhysicalDeviceMemoryProperties props;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &props);
+		for (uint i = 0; i < props.memoryTypeCount; i++) {
+			if ((props.memoryTypes[i].propertyFlags & hostVisible) == hostVisible) {
+				return hostVisible;
+			}
+		}
+		return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	}
+
 	uint Device::findMemoryType(uint typeFilterBits, VkMemoryPropertyFlags propertyFlags) const {
 		VkPhysicalDeviceMemoryProperties props;
 		vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &props);
@@ -86,6 +268,16 @@ namespace cp {
 				return;
 			}
 		}
+		// software rasterizers (lavapipe) are only picked when nothing else is there, mostly for headless CI machines
+		for (VkPhysicalDevice device : devices) {
+			if (!deviceValid(device)) continue;
+			VkPhysicalDeviceType type = getDeviceType(device);
+			if (type == VK_PHYSICAL_DEVICE_TYPE_CPU || type == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU) {
+				CP_DEBUG_LOG("falling back to a software Vulkan device");
+				physicalDevice_ = device;
+				return;
+			}
+		}
 		throw std::runtime_error("Couldnt find a suitable GPU");
 	}
 
@@ -106,9 +298,23 @@ namespace cp {
 		return extensionsReq.empty();
 	}
 
+	bool Device::extensionSupported(VkPhysicalDevice device, const char* extension) {
+		uint deviceExtCount = 0;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &deviceExtCount, nullptr);
+		std::vector<VkExtensionProperties> extensionsAvail(deviceExtCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &deviceExtCount, extensionsAvail.data());
+
+		for (const auto& extensionAvail : extensionsAvail) {
+			if (strcmp(extensionAvail.extensionName, extension) == 0) return true;
+		}
+		return false;
+	}
+
 	bool Device::deviceValid(VkPhysicalDevice device) {
-		if (!checkDeviceExtSupport(device)) return false;
 		if (!findQueueFamilies(device).complete()) return false;
+		if (headless()) return true;
+
+		if (!checkDeviceExtSupport(device)) return false;
 
 		SwapchainSupportDetails swapchainDetails = querySwapchainSupport(device);
 		if (swapchainDetails.formats.empty() || swapchainDetails.presentModes.empty()) return false;
@@ -136,12 +342,23 @@ namespace cp {
 			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
 				indices.graphicsFamily = i;
 
-			VkBool32 presentSupport;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
+			// without a surface nothing gets presented, the graphics queue stands in for the present queue
+			VkBool32 presentSupport = VK_FALSE;
+			if (mSurface != VK_NULL_HANDLE) {
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
+			}
+			else {
+				presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+			}
 
 			if (presentSupport)
 				indices.presentFamily = i;
 
+			// prefer pure transfer families, they usually map to the copy engines
+			bool transferOnly = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+			if (transferOnly && (!indices.transferFamily.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)))
+				indices.transferFamily = i;
+
 			i++;
 		}
 		return indices;
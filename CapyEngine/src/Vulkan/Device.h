@@ -2,35 +2,91 @@
 #include <Utils.h>
 
 namespace cp {
+	class MemoryAllocator;
+
 	class Device {
 	public:
-		Device(VkInstance instance, VkSurfaceKHR surface);
+		// surface may be VK_NULL_HANDLE for headless rendering, presentation support is not required then.
+		// The pipeline cache is loaded from pipelineCachePath and saved back on destruction, an empty path keeps it in memory
+		Device(VkInstance instance, VkSurfaceKHR surface, const std::filesystem::path& pipelineCachePath = {});
 		~Device();
 		VkDevice vkDevice() const { return mDevice; }
 		VkPhysicalDevice vkPhysicalDevice() const { return physicalDevice_; }
 		SwapchainSupportDetails swapchainDetails() const { return querySwapchainSupport(physicalDevice_); }
 		QueueFamilyIndices queueFamilies() const { return findQueueFamilies(physicalDevice_); }
 		VkQueue graphicsQueue() const { return mGraphicsQueue; }
+		// cached, queueFamilies() queries the physical device again
+		uint graphicsFamily() const { return mGraphicsFamily; }
+		// 0 when the graphics queue can't write timestamps
+		uint timestampValidBits() const { return mTimestampValidBits; }
+		// dedicated transfer queue if the device has one, the graphics queue otherwise
+		VkQueue transferQueue() const { return mTransferQueue; }
+		uint transferFamily() const { return mTransferFamily; }
+		bool dedicatedTransferQueue() const { return mTransferQueue != mGraphicsQueue; }
+		bool headless() const { return mSurface == VK_NULL_HANDLE; }
+		const VkPhysicalDeviceFeatures& features() const { return mFeatures; }
+		const VkPhysicalDeviceProperties& properties() const { return mProperties; }
+		// integrated and CPU devices share memory with the host, device local memory is usually host visible there
+		bool unifiedMemory() const {
+			return mProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || mProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+		}
+		// device local memory properties for static resources, host visible as well on UMA devices
+		VkMemoryPropertyFlags staticMemoryProperties() const;
+
+		bool drawIndirectCountSupported() const { return mCmdDrawIndexedIndirectCount != nullptr; }
+		void cmdDrawIndexedIndirectCount(
+			VkCommandBuffer cmd,
+			VkBuffer buffer, VkDeviceSize offset,
+			VkBuffer countBuffer, VkDeviceSize countOffset,
+			uint maxDrawCount, uint stride
+		) const;
 
 		void wait() const;
 		
 		uint findMemoryType(uint typeFilterBits, VkMemoryPropertyFlags propertyFlags) const;
 
+		// device memory for buffers and images is sub-allocated from shared blocks
+		MemoryAllocator& allocator() const { return *mAllocator; }
+
+		// every graphics and compute pipeline is created through it
+		VkPipelineCache pipelineCache() const { return mPipelineCache; }
+		// writes the cache now instead of only when the device is destroyed, no-op without a cache path
+		void savePipelineCache() const;
+
 	private:
 		void setSuitableDevice(const std::vector<VkPhysicalDevice>& devices);
 		bool deviceValid(VkPhysicalDevice device);
 		bool checkDeviceExtSupport(VkPhysicalDevice device);
+		bool extensionSupported(VkPhysicalDevice device, const char* extension);
 		QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) const;
 		SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice device) const;
 		VkPhysicalDeviceType getDeviceType(const VkPhysicalDevice device);
+		void createPipelineCache();
+		// the cache data of the file if it was written by this device and driver, empty otherwise
+		std::vector<char> loadPipelineCacheData() const;
 
 	private:
 		VkInstance mInstance = VK_NULL_HANDLE;
 		VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
 		VkDevice mDevice = VK_NULL_HANDLE;
 		VkQueue mGraphicsQueue = VK_NULL_HANDLE;
+		VkQueue mTransferQueue = VK_NULL_HANDLE;
+		uint mGraphicsFamily = 0;
+		uint mTransferFamily = 0;
+		uint mTimestampValidBits = 0;
 		VkSurfaceKHR mSurface = VK_NULL_HANDLE;
+		VkPhysicalDeviceFeatures mFeatures{};
+		VkPhysicalDeviceProperties mProperties{};
+
+		PFN_vkCmdDrawIndexedIndirectCountKHR mCmdDrawIndexedIndirectCount = nullptr;
+
+		std::unique_ptr<MemoryAllocator> mAllocator;
+
+		std::filesystem::path mPipelineCachePath;
+		VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
 
 		const std::array<const char*, 1> mDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		// enabled only when the physical device supports them
+		const std::array<const char*, 1> mOptionalDeviceExtensions = { VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "MemoryAllocator.h"
+#include "Device.h"
+
+namespace cp {
+	MemoryAllocator::MemoryAllocator(Device& device, VkDeviceSize blockSize)
+		: mDevice(device), mBlockSize(std::bit_ceil(blockSize)),
+		mMaxAllocationCount(device.properties().limits.maxMemoryAllocationCount) {}
+
+	MemoryAllocator::~MemoryAllocator() {
+		for (const Pool& pool : mPools) {
+			for (const auto& block : pool.blocks) {
+				if (!block->empty()) {
+					CP_DEBUG_ERROR("memory block destroyed with %u live allocations", block->allocationCount());
+				}
+			}
+		}
+		CP_DEBUG_LOG("memory allocator destroyed");
+	}
+
+	MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryResourceKind kind) {
+		uint memoryType = mDevice.findMemoryType(requirements.memoryTypeBits, properties);
+
+		std::lock_guard lock(mMutex);
+		Pool& memoryPool = pool(memoryType, kind);
+
+		MemoryAllocation allocation{};
+		if (requirements.size > mBlockSize / 2) {
+			memoryPool.blocks.push_back(createBlock(memoryType, requirements.size, true));
+			memoryPool.blocks.back()->allocate(requirements.size, requirements.alignment, allocation);
+			return allocation;
+		}
+
+		for (const auto& block : memoryPool.blocks) {
+			if (!block->dedicated() && block->allocate(requirements.size, requirements.alignment, allocation)) {
+				return allocation;
+			}
+		}
+
+		memoryPool.blocks.push_back(createBlock(memoryType, mBlockSize, false));
+		memoryPool.blocks.back()->allocate(requirements.size, requirements.alignment, allocation);
+		return allocation;
+	}
+
+	void MemoryAllocator::free(MemoryAllocation& allocation) {
+		if (!allocation.block) return;
+
+		std::lock_guard lock(mMutex);
+		MemoryBlock* block = allocation.block;
+		block->free(allocation);
+		allocation = {};
+
+		if (!block->empty()) return;
+
+		// dedicated blocks go right away, one empty shared block per pool is kept around for reuse
+		for (Pool& memoryPool : mPools) {
+			auto it = std::find_if(memoryPool.blocks.begin(), memoryPool.blocks.end(), [&](const auto& b) { return b.get() == block; });
+			if (it == memoryPool.blocks.end()) continue;
+
+			size_t emptyShared = std::count_if(memoryPool.blocks.begin(), memoryPool.blocks.end(), [](const auto& b) {
+				return !b->dedicated() && b->empty();
+			});
+
+			if (block->dedicated() || emptyShared > 1) {
+				memoryPool.blocks.erase(it);
+				mDeviceAllocationCount--;
+			}
+			return;
+		}
+	}
+
+	MemoryStatistics MemoryAllocator::statistics() const {
+		std::lock_guard lock(mMutex);
+
+		MemoryStatistics stats{};
+		VkDeviceSize freeBytes = 0;
+		for (const Pool& memoryPool : mPools) {
+			for (const auto& block : memoryPool.blocks) {
+				stats.blockCount++;
+				stats.dedicatedBlockCount += block->dedicated() ? 1 : 0;
+				stats.allocationCount += block->allocationCount();
+				stats.bytesReserved += block->size();
+				stats.bytesUsed += block->bytesUsed();
+				stats.bytesAllocated += block->bytesAllocated();
+
+				if (!block->dedicated()) {
+					freeBytes += block->size() - block->bytesAllocated();
+					stats.largestFreeRange = std::max(stats.largestFreeRange, block->largestFreeRange());
+				}
+			}
+		}
+
+		stats.fragmentation = freeBytes > 0 ? 1.f - (float)stats.largestFreeRange / freeBytes : 0.f;
+		return stats;
+	}
+
+	MemoryAllocator::Pool& MemoryAllocator::pool(uint memoryType, MemoryResourceKind kind) {
+		for (Pool& memoryPool : mPools) {
+			if (memoryPool.memoryType == memoryType && memoryPool.kind == kind) {
+				return memoryPool;
+			}
+		}
+
+		Pool& memoryPool = mPools.emplace_back();
+		memoryPool.memoryType = memoryType;
+		memoryPool.kind = kind;
+		return memoryPool;
+	}
+
+	std::unique_ptr<MemoryBlock> MemoryAllocator::createBlock(uint memoryType, VkDeviceSize size, bool dedicated) {
+		if (mDeviceAllocationCount >= mMaxAllocationCount) {
+			throw std::runtime_error("maxMemoryAllocationCount reached");
+		}
+
+		// the buddy levels need a power of two, dedicated blocks only ever hold one allocation
+		VkDeviceSize blockSize = dedicated ? size : std::bit_ceil(size);
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = blockSize;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkResult allocResult = vkAllocateMemory(mDevice.vkDevice(), &allocInfo, nullptr, &memory);
+		checkVkResult(allocResult, "failed to allocate device memory block");
+		mDeviceAllocationCount++;
+
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(mDevice.vkPhysicalDevice(), &memProperties);
+
+		void* mapped = nullptr;
+		if (memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			VkResult mapResult = vkMapMemory(mDevice.vkDevice(), memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+			checkVkResult(mapResult, "failed to map device memory block");
+		}
+
+		return std::make_unique<MemoryBlock>(mDevice.vkDevice(), memory, blockSize, mapped, dedicated);
+	}
+
+	MemoryBlock::MemoryBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size, void* mapped, bool dedicated)
+		: mDevice(device), mMemory(memory), mSize(size), mMapped(mapped), mDedicated(dedicated) {
+
+		uint levels = 1;
+		if (!mDedicated) {
+			while (levelSize(levels - 1) > MemoryAllocator::minAllocationSize) {
+				levels++;
+			}
+		}
+
+		mFreeLists.resize(levels);
+		mFreeLists[0].insert(0);
+	}
+
+	MemoryBlock::~MemoryBlock() {
+		if (mMapped) {
+			vkUnmapMemory(mDevice, mMemory);
+		}
+		vkFreeMemory(mDevice, mMemory, nullptr);
+	}
+
+	bool MemoryBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation& allocation) {
+		// ranges at a level are aligned to their own size, so the alignment is covered by rounding up to it
+		VkDeviceSize rangeSize = std::bit_ceil(std::max({ size, alignment, MemoryAllocator::minAllocationSize }));
+		if (mDedicated) {
+			rangeSize = mSize;
+		}
+		if (rangeSize > mSize) return false;
+
+		uint level = 0;
+		while (level + 1 < mFreeLists.size() && levelSize(level + 1) >= rangeSize) {
+			level++;
+		}
+
+		// smallest free range that fits, split down to the target level
+		int freeLevel = (int)level;
+		while (freeLevel >= 0 && mFreeLists[freeLevel].empty()) {
+			freeLevel--;
+		}
+		if (freeLevel < 0) return false;
+
+		VkDeviceSize offset = *mFreeLists[freeLevel].begin();
+		mFreeLists[freeLevel].erase(mFreeLists[freeLevel].begin());
+		for (uint splitLevel = freeLevel + 1; splitLevel <= level; splitLevel++) {
+			mFreeLists[splitLevel].insert(offset + levelSize(splitLevel));
+		}
+
+		allocation.memory = mMemory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.mapped = mMapped ? static_cast<char*>(mMapped) + offset : nullptr;
+		allocation.block = this;
+		allocation.level = level;
+
+		mAllocationCount++;
+		mBytesUsed += size;
+		mBytesAllocated += levelSize(level);
+		return true;
+	}
+
+	void MemoryBlock::free(const MemoryAllocation& allocation) {
+		mAllocationCount--;
+		mBytesUsed -= allocation.size;
+		mBytesAllocated -= levelSize(allocation.level);
+
+		VkDeviceSize offset = allocation.offset;
+		uint level = allocation.level;
+
+		// merge with the buddy as long as it is free as well
+		while (level > 0) {
+			VkDeviceSize buddy = offset ^ levelSize(level);
+			auto it = mFreeLists[level].find(buddy);
+			if (it == mFreeLists[level].end()) break;
+
+			mFreeLists[level].erase(it);
+			offset = std::min(offset, buddy);
+			level--;
+		}
+		mFreeLists[level].insert(offset);
+	}
+
+	VkDeviceSize MemoryBlock::largestFreeRange() const {
+		for (uint level = 0; level < mFreeLists.size(); level++) {
+			if (!mFreeLists[level].empty()) {
+				return levelSize(level);
+			}
+		}
+		return 0;
+	}
+}
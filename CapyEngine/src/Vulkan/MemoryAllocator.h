@@ -0,0 +1,110 @@
+#pragma once
+#include <Utils.h>
+
+namespace cp {
+	class Device;
+	class MemoryBlock;
+
+	struct MemoryAllocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		// persistently mapped pointer at offset, null unless the memory is host visible
+		void* mapped = nullptr;
+
+		MemoryBlock* block = nullptr;
+		uint level = 0;
+	};
+
+	// linear resources (buffers) and optimally tiled images never share a block,
+	// so bufferImageGranularity doesn't have to be padded between neighbours
+	enum class MemoryResourceKind : uint {
+		Linear,
+		Optimal,
+	};
+
+	struct MemoryStatistics {
+		uint blockCount = 0;
+		uint dedicatedBlockCount = 0;
+		uint allocationCount = 0;
+		// device memory held by the blocks
+		VkDeviceSize bytesReserved = 0;
+		// bytes requested by the allocations
+		VkDeviceSize bytesUsed = 0;
+		// requested sizes rounded up to their buddy sizes, the difference to bytesUsed is internal fragmentation
+		VkDeviceSize bytesAllocated = 0;
+		VkDeviceSize largestFreeRange = 0;
+		// 1 - largest free range / free bytes, 0 when all free memory is one range
+		float fragmentation = 0.f;
+	};
+
+	// One buddy allocator per device memory block, blocks are allocated per memory type and resource kind
+	// on demand. Requests larger than half a block get a dedicated block of their own. Host visible blocks
+	// are mapped once when they are created.
+	class MemoryAllocator {
+	public:
+		static constexpr VkDeviceSize defaultBlockSize = 64ull << 20;
+		static constexpr VkDeviceSize minAllocationSize = 256;
+
+		MemoryAllocator(Device& device, VkDeviceSize blockSize = defaultBlockSize);
+		~MemoryAllocator();
+
+		MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryResourceKind kind);
+		void free(MemoryAllocation& allocation);
+
+		MemoryStatistics statistics() const;
+
+	private:
+		struct Pool {
+			uint memoryType = 0;
+			MemoryResourceKind kind = MemoryResourceKind::Linear;
+			std::vector<std::unique_ptr<MemoryBlock>> blocks;
+		};
+
+		Pool& pool(uint memoryType, MemoryResourceKind kind);
+		std::unique_ptr<MemoryBlock> createBlock(uint memoryType, VkDeviceSize size, bool dedicated);
+
+	private:
+		Device& mDevice;
+		VkDeviceSize mBlockSize;
+		uint mMaxAllocationCount = 0;
+		uint mDeviceAllocationCount = 0;
+
+		std::vector<Pool> mPools;
+		mutable std::mutex mMutex;
+	};
+
+	class MemoryBlock {
+	public:
+		MemoryBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size, void* mapped, bool dedicated);
+		~MemoryBlock();
+
+		// returns false when no free range is large enough
+		bool allocate(VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation& allocation);
+		void free(const MemoryAllocation& allocation);
+
+		bool empty() const { return mAllocationCount == 0; }
+		bool dedicated() const { return mDedicated; }
+		VkDeviceSize size() const { return mSize; }
+		uint allocationCount() const { return mAllocationCount; }
+		VkDeviceSize bytesUsed() const { return mBytesUsed; }
+		VkDeviceSize bytesAllocated() const { return mBytesAllocated; }
+		VkDeviceSize largestFreeRange() const;
+
+	private:
+		VkDeviceSize levelSize(uint level) const { return mSize >> level; }
+
+	private:
+		VkDevice mDevice;
+		VkDeviceMemory mMemory;
+		VkDeviceSize mSize;
+		void* mMapped;
+		bool mDedicated;
+
+		// free offsets per level, level 0 is the whole block
+		std::vector<std::set<VkDeviceSize>> mFreeLists;
+		uint mAllocationCount = 0;
+		VkDeviceSize mBytesUsed = 0;
+		VkDeviceSize mBytesAllocated = 0;
+	};
+}
@@ -0,0 +1,105 @@
+#include "OffscreenTarget.h"
+#include "ResourceManager.h"
+
+namespace cp {
+	OffscreenTarget::OffscreenTarget(Device& device, const OffscreenTargetSpecification& spec)
+		: mSpec(spec), mDevice(device) {
+
+		create();
+	}
+
+	OffscreenTarget::~OffscreenTarget() {
+		destroy();
+		CP_DEBUG_LOG("offscreen images destroyed");
+	}
+
+	std::vector<RenderTarget::Image> OffscreenTarget::images() const {
+		std::vector<Image> images;
+		for (size_t i = 0; i < mImages.size(); i++) {
+			images.push_back({ mImages[i], mImageViews[i] });
+		}
+		return images;
+	}
+
+	void OffscreenTarget::destroy() {
+		for (size_t i = 0; i < mImages.size(); i++) {
+			vkDestroyImageView(mDevice.vkDevice(), mImageViews[i], nullptr);
+			vkDestroyImage(mDevice.vkDevice(), mImages[i], nullptr);
+			mDevice.allocator().free(mImageMemory[i]);
+		}
+		mImages.clear();
+		mImageMemory.clear();
+		mImageViews.clear();
+	}
+
+	void OffscreenTarget::create() {
+		mImages.resize(mSpec.imageCount);
+		mImageMemory.resize(mSpec.imageCount);
+		mImageViews.resize(mSpec.imageCount);
+
+		for (uint i = 0; i < mSpec.imageCount; i++) {
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = mSpec.format;
+			imageInfo.extent = { mSpec.width, mSpec.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkResult imageResult = vkCreateImage(mDevice.vkDevice(), &imageInfo, nullptr, &mImages[i]);
+			checkVkResult(imageResult, "failed to create offscreen image");
+
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(mDevice.vkDevice(), mImages[i], &requirements);
+
+			mImageMemory[i] = mDevice.allocator().allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryResourceKind::Optimal);
+			vkBindImageMemory(mDevice.vkDevice(), mImages[i], mImageMemory[i].memory, mImageMemory[i].offset);
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = mImages[i];
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = mSpec.format;
+			viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			VkResult viewResult = vkCreateImageView(mDevice.vkDevice(), &viewInfo, nullptr, &mImageViews[i]);
+			checkVkResult(viewResult, "failed to create offscreen image view");
+		}
+	}
+
+	std::vector<uint8_t> OffscreenTarget::readback(uint imageIdx) const {
+		CP_ASSERT(imageIdx < mImages.size(), "invalid offscreen image index");
+		CP_ASSERT(mSpec.format == VK_FORMAT_R8G8B8A8_UNORM || mSpec.format == VK_FORMAT_R8G8B8A8_SRGB || mSpec.format == VK_FORMAT_B8G8R8A8_UNORM || mSpec.format == VK_FORMAT_B8G8R8A8_SRGB,
+			"readback only supports 4 byte color formats");
+
+		size_t size = (size_t)mSpec.width * mSpec.height * 4;
+
+		auto [buffer, memory] = ResourceManager::createBuffer(
+			mDevice, size,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		// the render pass leaves the image in TRANSFER_SRC_OPTIMAL (finalLayout)
+		ResourceManager::copyImageToBuffer(mDevice, mImages[imageIdx], extent(), buffer);
+
+		std::vector<uint8_t> pixels(size);
+		memcpy(pixels.data(), memory.mapped, size);
+
+		ResourceManager::destroyBuffer(mDevice, buffer, memory);
+		return pixels;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "RenderTarget.h"
+#include "MemoryAllocator.h"
+
+namespace cp {
+	struct OffscreenTargetSpecification {
+		uint width = 1280;
+		uint height = 720;
+		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+		// used round robin, one per frame in flight is enough
+		uint imageCount = 2;
+	};
+
+	class OffscreenTarget : public RenderTarget {
+	public:
+		OffscreenTarget(Device& device, const OffscreenTargetSpecification& spec = {});
+		~OffscreenTarget();
+
+		VkExtent2D extent() const override { return { mSpec.width, mSpec.height }; }
+		VkFormat colorFormat() const override { return mSpec.format; }
+		std::vector<Image> images() const override;
+		VkImageLayout finalLayout() const override { return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; }
+		bool presentable() const override { return false; }
+
+		void destroy() override;
+		void create() override;
+
+		// copies the image into host memory, tightly packed rows in the target format,
+		// the image must not be written by the GPU anymore (wait for the frame first)
+		std::vector<uint8_t> readback(uint imageIdx) const;
+
+	private:
+		OffscreenTargetSpecification mSpec;
+		Device& mDevice;
+		std::vector<VkImage> mImages;
+		std::vector<MemoryAllocation> mImageMemory;
+		std::vector<VkImageView> mImageViews;
+	};
+}
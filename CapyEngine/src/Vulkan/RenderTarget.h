@@ -0,0 +1,28 @@
+#pragma once
+#include "Device.h"
+
+namespace cp {
+	// set of color images the renderer draws into, implemented by the Swapchain
+	// and by OffscreenTarget for headless rendering
+	class RenderTarget {
+	public:
+		struct Image {
+			VkImage image;
+			VkImageView view;
+		};
+
+		virtual ~RenderTarget() = default;
+
+		virtual VkExtent2D extent() const = 0;
+		virtual VkFormat colorFormat() const = 0;
+		virtual std::vector<Image> images() const = 0;
+
+		// layout the render pass leaves the images in
+		virtual VkImageLayout finalLayout() const = 0;
+		// images are acquired from and presented to a surface
+		virtual bool presentable() const = 0;
+
+		virtual void destroy() = 0;
+		virtual void create() = 0;
+	};
+}
@@ -1,7 +1,9 @@
 #include "ResourceManager.h"
+#include "Uploader.h"
 
 namespace cp {
 	VkCommandPool ResourceManager::sCmdPool = VK_NULL_HANDLE;
+	std::unique_ptr<Uploader> ResourceManager::sUploader;
 
 	void ResourceManager::init(Device& device) {
 		VkCommandPoolCreateInfo createInfo{};
@@ -11,9 +13,12 @@ namespace cp {
 
 		VkResult result = vkCreateCommandPool(device.vkDevice(), &createInfo, nullptr, &sCmdPool);
 		checkVkResult(result, "failed to create resource command pool");
+
+		sUploader = std::make_unique<Uploader>(device);
 	}
 
 	void ResourceManager::cleanup(Device& device) {
+		sUploader.reset();
 		vkDestroyCommandPool(device.vkDevice(), sCmdPool, nullptr);
 	}
 
@@ -21,7 +26,8 @@ namespace cp {
 		Device& device,
 		size_t size,
 		VkBufferUsageFlags usage,
-		VkMemoryPropertyFlags memProperties
+		VkMemoryPropertyFlags memProperties,
+		BufferSharing sharing
 	) {
 		Buffer buffer{};
 
@@ -31,33 +37,100 @@ namespace cp {
 		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		createInfo.size = size;
 
+		// without a dedicated transfer queue every access comes from the graphics family anyway
+		uint queueFamilies[2];
+		if (sharing == BufferSharing::Concurrent && device.dedicatedTransferQueue()) {
+			queueFamilies[0] = device.graphicsFamily();
+			queueFamilies[1] = device.transferFamily();
+			createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			createInfo.queueFamilyIndexCount = 2;
+			createInfo.pQueueFamilyIndices = queueFamilies;
+		}
+
 		VkResult result = vkCreateBuffer(device.vkDevice(), &createInfo, nullptr, &buffer.buffer);
 		checkVkResult(result, "failed to create a buffer");
 
 		VkMemoryRequirements requirements;
 		vkGetBufferMemoryRequirements(device.vkDevice(), buffer.buffer, &requirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = requirements.size;
-		allocInfo.memoryTypeIndex = device.findMemoryType(requirements.memoryTypeBits, memProperties);
-
-		VkResult allocResult = vkAllocateMemory(device.vkDevice(), &allocInfo, nullptr, &buffer.memory);
-		checkVkResult(allocResult, "failed to allocate vertex buffer memory");
-
-		vkBindBufferMemory(device.vkDevice(), buffer.buffer, buffer.memory, 0);
+		buffer.memory = device.allocator().allocate(requirements, memProperties, MemoryResourceKind::Linear);
+		vkBindBufferMemory(device.vkDevice(), buffer.buffer, buffer.memory.memory, buffer.memory.offset);
 
 		return buffer;
 	}
 
-	void ResourceManager::fillBuffer(Device& device, VkDeviceMemory buffMemory, size_t size, const void* data) {
-		void* dataTemp;
-		vkMapMemory(device.vkDevice(), buffMemory, 0, size, 0, &dataTemp);
-		memcpy(dataTemp, data, size);
-		vkUnmapMemory(device.vkDevice(), buffMemory);
+	void ResourceManager::destroyBuffer(Device& device, VkBuffer buffer, MemoryAllocation& memory) {
+		vkDestroyBuffer(device.vkDevice(), buffer, nullptr);
+		device.allocator().free(memory);
+	}
+
+	void ResourceManager::fillBuffer(const MemoryAllocation& memory, size_t size, const void* data) {
+		CP_ASSERT(memory.mapped, "buffer memory is not host visible");
+		memcpy(memory.mapped, data, size);
 	}
 
 	void ResourceManager::copyBuffer(Device& device, VkBuffer src, VkBuffer dst, size_t size) {
+		VkCommandBuffer commandBuffer = beginOneTimeCommands(device);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = 0;
+		copyRegion.dstOffset = 0;
+		copyRegion.size = size;
+
+		vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
+
+		submitOneTimeCommands(device, commandBuffer, "failed to copy buffer");
+	}
+
+	void ResourceManager::copyBuffer(Device& device, VkBuffer src, VkBuffer dst, std::span<const VkBufferCopy> regions) {
+		if (regions.empty()) return;
+
+		VkCommandBuffer commandBuffer = beginOneTimeCommands(device);
+		vkCmdCopyBuffer(commandBuffer, src, dst, (uint)regions.size(), regions.data());
+		submitOneTimeCommands(device, commandBuffer, "failed to copy buffer");
+	}
+
+	UploadFuture ResourceManager::uploadBuffer(
+		VkBuffer dst,
+		const MemoryAllocation& dstMemory,
+		const void* data,
+		size_t size,
+		VkAccessFlags dstAccess,
+		VkPipelineStageFlags dstStage,
+		VkDeviceSize dstOffset,
+		BufferSharing dstSharing
+	) {
+		return sUploader->upload(dst, dstMemory, data, size, dstAccess, dstStage, dstOffset, dstSharing);
+	}
+
+	void ResourceManager::flushUploads() {
+		sUploader->flush();
+	}
+
+	void ResourceManager::collectUploads() {
+		sUploader->collect();
+	}
+
+	void ResourceManager::copyImageToBuffer(Device& device, VkImage src, VkExtent2D extent, VkBuffer dst) {
+		VkCommandBuffer commandBuffer = beginOneTimeCommands(device);
+
+		VkBufferImageCopy copyRegion{};
+		copyRegion.bufferOffset = 0;
+		copyRegion.bufferRowLength = 0;
+		copyRegion.bufferImageHeight = 0;
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = 0;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageOffset = { 0, 0, 0 };
+		copyRegion.imageExtent = { extent.width, extent.height, 1 };
+
+		vkCmdCopyImageToBuffer(commandBuffer, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, 1, &copyRegion);
+
+		submitOneTimeCommands(device, commandBuffer, "failed to copy image to buffer");
+	}
+
+	VkCommandBuffer ResourceManager::beginOneTimeCommands(Device& device) {
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -72,14 +145,11 @@ namespace cp {
 		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 		VkResult beginResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
-		
-		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0;
-		copyRegion.dstOffset = 0;
-		copyRegion.size = size;
-
-		vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
+		checkVkResult(beginResult, "failed to begin one time command buffer");
+		return commandBuffer;
+	}
 
+	void ResourceManager::submitOneTimeCommands(Device& device, VkCommandBuffer commandBuffer, std::string_view errorMessage) {
 		VkResult endResult = vkEndCommandBuffer(commandBuffer);
 
 		VkSubmitInfo submitInfo{};
@@ -91,7 +161,7 @@ namespace cp {
 		VkResult submitResult = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
 		vkQueueWaitIdle(queue);
 
-		checkVkResult({ beginResult, endResult, submitResult }, "failed to copy buffer");
+		checkVkResult({ endResult, submitResult }, errorMessage);
 
 		vkFreeCommandBuffers(device.vkDevice(), sCmdPool, 1, &commandBuffer);
 	}
@@ -1,12 +1,23 @@
 #pragma once
 #include "Device.h"
+#include "MemoryAllocator.h"
 
 namespace cp {
 	struct Buffer {
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		MemoryAllocation memory{};
 	};
 
+	// concurrent buffers are shared by the graphics and the dedicated transfer queue without ownership
+	// transfers, for buffers uploaded into again while frames in flight read other ranges of them
+	enum class BufferSharing {
+		Exclusive,
+		Concurrent,
+	};
+
+	class Uploader;
+	class UploadFuture;
+
 	class ResourceManager {
 	public:
 		static void init(Device& device);
@@ -16,14 +27,45 @@ namespace cp {
 			Device& device,
 			size_t size,
 			VkBufferUsageFlags usage,
-			VkMemoryPropertyFlags memProperties
+			VkMemoryPropertyFlags memProperties,
+			BufferSharing sharing = BufferSharing::Exclusive
 		);
 
-		static void fillBuffer(Device& device, VkDeviceMemory buffMemory, size_t size, const void* data);
+		static void destroyBuffer(Device& device, VkBuffer buffer, MemoryAllocation& memory);
+
+		// memory has to be host visible
+		static void fillBuffer(const MemoryAllocation& memory, size_t size, const void* data);
 
 		static void copyBuffer(Device& device, VkBuffer src, VkBuffer dst, size_t size);
+		// waits for the copies to finish
+		static void copyBuffer(Device& device, VkBuffer src, VkBuffer dst, std::span<const VkBufferCopy> regions);
+
+		// queues a copy of data into dst on the shared Uploader, see Uploader for the synchronization
+		static UploadFuture uploadBuffer(
+			VkBuffer dst,
+			const MemoryAllocation& dstMemory,
+			const void* data,
+			size_t size,
+			VkAccessFlags dstAccess,
+			VkPipelineStageFlags dstStage,
+			VkDeviceSize dstOffset = 0,
+			BufferSharing dstSharing = BufferSharing::Exclusive
+		);
+
+		// submits the queued copies, has to happen before graphics work using their buffers is submitted
+		static void flushUploads();
+		static void collectUploads();
+		static Uploader& uploader() { return *sUploader; }
+
+		// image has to be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+		static void copyImageToBuffer(Device& device, VkImage src, VkExtent2D extent, VkBuffer dst);
+
+	private:
+		static VkCommandBuffer beginOneTimeCommands(Device& device);
+		static void submitOneTimeCommands(Device& device, VkCommandBuffer commandBuffer, std::string_view errorMessage);
 
 	private:
 		static VkCommandPool sCmdPool;
+		static std::unique_ptr<Uploader> sUploader;
 	};
 }
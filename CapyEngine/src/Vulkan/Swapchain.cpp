@@ -41,7 +41,7 @@ namespace cp {
 		return realExtent;
 	}
 
-	std::vector<Swapchain::Image> Swapchain::images() const {
+	std::vector<RenderTarget::Image> Swapchain::images() const {
 		std::vector<Image> images;
 		for (size_t i = 0; i < mImages.size(); i++) {
 			images.push_back({ mImages[i], mImageViews[i] });
@@ -1,25 +1,24 @@
 #pragma once
 #include "Device.h"
 #include "Window.h"
+#include "RenderTarget.h"
 
 namespace cp {
-	class Swapchain {
+	class Swapchain : public RenderTarget {
 	public:
-		struct Image {
-			VkImage image;
-			VkImageView view;
-		};
-
 		Swapchain(Device& device, Window& window);
 		~Swapchain();
 
 		VkSwapchainKHR vkHandle() const { return mSwapchain; }
-		VkExtent2D extent() const { return mSwapExtent; }
+		VkExtent2D extent() const override { return mSwapExtent; }
 		VkSurfaceFormatKHR format() const { return mSurfaceFormat; }
-		std::vector<Image> images() const;
+		VkFormat colorFormat() const override { return mSurfaceFormat.format; }
+		std::vector<Image> images() const override;
+		VkImageLayout finalLayout() const override { return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+		bool presentable() const override { return true; }
 
-		void destroy();
-		void create();
+		void destroy() override;
+		void create() override;
 
 	private:
 		void createSwapchain();
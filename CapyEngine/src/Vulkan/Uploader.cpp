@@ -0,0 +1,346 @@
+#include "Uploader.h"
+
+namespace cp {
+	static constexpr VkDeviceSize sRingAlignment = 16;
+
+	bool UploadFuture::ready() const {
+		if (!mState || mState->done) return true;
+		if (!mState->submitted) return false;
+		return vkGetFenceStatus(mState->device, mState->fence) == VK_SUCCESS;
+	}
+
+	void UploadFuture::wait() const {
+		if (!mState || mState->done) return;
+		if (!mState->submitted) {
+			mState->uploader->flush();
+		}
+		vkWaitForFences(mState->device, 1, &mState->fence, VK_TRUE, std::numeric_limits<uint64>::max());
+	}
+
+	Uploader::Uploader(Device& device, VkDeviceSize ringSize)
+		: mDevice(device), mRingSize(ringSize) {
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = mDevice.queueFamilies().graphicsFamily.value();
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		VkResult graphicsResult = vkCreateCommandPool(mDevice.vkDevice(), &poolInfo, nullptr, &mGraphicsCmdPool);
+
+		poolInfo.queueFamilyIndex = mDevice.transferFamily();
+		VkResult transferResult = vkCreateCommandPool(mDevice.vkDevice(), &poolInfo, nullptr, &mTransferCmdPool);
+		checkVkResult({ graphicsResult, transferResult }, "failed to create upload command pools");
+
+		mRing = ResourceManager::createBuffer(
+			mDevice, mRingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+	}
+
+	Uploader::~Uploader() {
+		wait();
+		ResourceManager::destroyBuffer(mDevice, mRing.buffer, mRing.memory);
+		vkDestroyCommandPool(mDevice.vkDevice(), mTransferCmdPool, nullptr);
+		vkDestroyCommandPool(mDevice.vkDevice(), mGraphicsCmdPool, nullptr);
+		CP_DEBUG_LOG("uploader destroyed");
+	}
+
+	UploadFuture Uploader::upload(
+		VkBuffer dst,
+		const MemoryAllocation& dstMemory,
+		const void* data,
+		size_t size,
+		VkAccessFlags dstAccess,
+		VkPipelineStageFlags dstStage,
+		VkDeviceSize dstOffset,
+		BufferSharing dstSharing
+	) {
+		if (size == 0) return {};
+
+		// UMA and other host visible memory
+		if (dstMemory.mapped) {
+			memcpy(static_cast<char*>(dstMemory.mapped) + dstOffset, data, size);
+			mStats.bytesDirect += size;
+			return {};
+		}
+
+		VkBuffer src = VK_NULL_HANDLE;
+		VkDeviceSize srcOffset = 0;
+
+		if (size > mRingSize / 2) {
+			Buffer staging = ResourceManager::createBuffer(
+				mDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+			ResourceManager::fillBuffer(staging.memory, size, data);
+
+			if (!mBatch.state) beginBatch();
+			mBatch.oversized.push_back(staging);
+			src = staging.buffer;
+		}
+		else {
+			// make room by submitting what is pending, then by waiting for the oldest batch
+			while (!allocateRing(size, srcOffset)) {
+				if (!mBatch.copies.empty()) {
+					flush();
+				}
+				else {
+					CP_ASSERT(!mInFlight.empty(), "staging ring is empty but the upload doesn't fit");
+					vkWaitForFences(mDevice.vkDevice(), 1, &mInFlight.front().state->fence, VK_TRUE, std::numeric_limits<uint64>::max());
+					collect();
+				}
+			}
+
+			if (!mBatch.state) beginBatch();
+			memcpy(static_cast<char*>(mRing.memory.mapped) + srcOffset, data, size);
+			mBatch.usesRing = true;
+			mBatch.ringEnd = mRingHead;
+			src = mRing.buffer;
+		}
+
+		Copy copy{};
+		copy.src = src;
+		copy.dst = dst;
+		copy.region = { srcOffset, dstOffset, size };
+		copy.dstAccess = dstAccess;
+		copy.dstStage = dstStage;
+		copy.dstSharing = dstSharing;
+		mBatch.copies.push_back(copy);
+
+		mStats.copies++;
+		mStats.bytesStaged += size;
+
+		UploadFuture future{};
+		future.mState = mBatch.state;
+		return future;
+	}
+
+	void Uploader::flush() {
+		if (mBatch.copies.empty()) return;
+
+		submit(mBatch);
+		mInFlight.push_back(std::move(mBatch));
+		mBatch = {};
+	}
+
+	void Uploader::collect() {
+		// batches finish in submission order, the ring tail only ever moves forward
+		while (!mInFlight.empty() && vkGetFenceStatus(mDevice.vkDevice(), mInFlight.front().state->fence) == VK_SUCCESS) {
+			retire(mInFlight.front());
+			mInFlight.pop_front();
+		}
+	}
+
+	void Uploader::wait() {
+		flush();
+		for (Batch& batch : mInFlight) {
+			vkWaitForFences(mDevice.vkDevice(), 1, &batch.state->fence, VK_TRUE, std::numeric_limits<uint64>::max());
+			retire(batch);
+		}
+		mInFlight.clear();
+	}
+
+	void Uploader::beginBatch() {
+		mBatch.state = std::make_shared<UploadFuture::State>();
+		mBatch.state->uploader = this;
+		mBatch.state->device = mDevice.vkDevice();
+	}
+
+	bool Uploader::allocateRing(VkDeviceSize size, VkDeviceSize& offset) {
+		bool live = mRingFull || mRingHead != mRingTail;
+		if (!live) {
+			mRingHead = 0;
+			mRingTail = 0;
+		}
+
+		VkDeviceSize start = (mRingHead + sRingAlignment - 1) / sRingAlignment * sRingAlignment;
+
+		if (mRingFull) return false;
+
+		if (!live || mRingHead > mRingTail) {
+			// free space is the end of the ring and everything before the tail
+			if (start + size <= mRingSize) {
+				offset = start;
+			}
+			else if (size <= mRingTail) {
+				offset = 0;
+			}
+			else {
+				return false;
+			}
+		}
+		else {
+			if (start + size > mRingTail) return false;
+			offset = start;
+		}
+
+		mRingHead = offset + size;
+		if (mRingHead == mRingSize) {
+			mRingHead = 0;
+		}
+		mRingFull = mRingHead == mRingTail;
+		return true;
+	}
+
+	void Uploader::submit(Batch& batch) {
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkResult fenceResult = vkCreateFence(mDevice.vkDevice(), &fenceInfo, nullptr, &batch.state->fence);
+		checkVkResult(fenceResult, "failed to create upload fence");
+
+		bool ownershipTransfer = mDevice.dedicatedTransferQueue();
+		uint graphicsFamily = mDevice.graphicsFamily();
+
+		batch.transferCmd = beginCommands(ownershipTransfer ? mTransferCmdPool : mGraphicsCmdPool);
+
+		VkAccessFlags dstAccess = 0;
+		VkPipelineStageFlags dstStage = 0;
+		for (const Copy& copy : batch.copies) {
+			vkCmdCopyBuffer(batch.transferCmd, copy.src, copy.dst, 1, &copy.region);
+			dstAccess |= copy.dstAccess;
+			dstStage |= copy.dstStage;
+		}
+
+		if (!ownershipTransfer) {
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = dstAccess;
+			vkCmdPipelineBarrier(batch.transferCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			VkResult endResult = vkEndCommandBuffer(batch.transferCmd);
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &batch.transferCmd;
+
+			VkResult submitResult = vkQueueSubmit(mDevice.graphicsQueue(), 1, &submitInfo, batch.state->fence);
+			checkVkResult({ endResult, submitResult }, "failed to submit upload batch");
+		}
+		else {
+			// ownership transfers need buffer barriers, one per exclusive destination covering the
+			// copied range, ranges of the buffer that frames in flight read are left alone
+			std::vector<VkBufferMemoryBarrier> barriers;
+			for (const Copy& copy : batch.copies) {
+				if (copy.dstSharing == BufferSharing::Concurrent) continue;
+
+				auto barrier = std::find_if(barriers.begin(), barriers.end(), [&](const VkBufferMemoryBarrier& b) { return b.buffer == copy.dst; });
+				if (barrier == barriers.end()) {
+					VkBufferMemoryBarrier& added = barriers.emplace_back();
+					added.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					added.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					added.dstAccessMask = copy.dstAccess; // for the acquire, cleared for the release
+					added.srcQueueFamilyIndex = mDevice.transferFamily();
+					added.dstQueueFamilyIndex = graphicsFamily;
+					added.buffer = copy.dst;
+					added.offset = copy.region.dstOffset;
+					added.size = copy.region.size;
+					continue;
+				}
+
+				VkDeviceSize begin = std::min(barrier->offset, copy.region.dstOffset);
+				VkDeviceSize end = std::max(barrier->offset + barrier->size, copy.region.dstOffset + copy.region.size);
+				barrier->offset = begin;
+				barrier->size = end - begin;
+				barrier->dstAccessMask |= copy.dstAccess;
+			}
+
+			if (!barriers.empty()) {
+				std::vector<VkBufferMemoryBarrier> releases = barriers;
+				for (VkBufferMemoryBarrier& release : releases) {
+					release.dstAccessMask = 0; // ignored by the releasing queue
+				}
+				vkCmdPipelineBarrier(
+					batch.transferCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+					0, 0, nullptr, (uint)releases.size(), releases.data(), 0, nullptr
+				);
+			}
+			VkResult endResult = vkEndCommandBuffer(batch.transferCmd);
+
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			VkResult semaphoreResult = vkCreateSemaphore(mDevice.vkDevice(), &semaphoreInfo, nullptr, &batch.semaphore);
+
+			VkSubmitInfo transferSubmit{};
+			transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			transferSubmit.commandBufferCount = 1;
+			transferSubmit.pCommandBuffers = &batch.transferCmd;
+			transferSubmit.signalSemaphoreCount = 1;
+			transferSubmit.pSignalSemaphores = &batch.semaphore;
+
+			VkResult transferResult = vkQueueSubmit(mDevice.transferQueue(), 1, &transferSubmit, VK_NULL_HANDLE);
+			checkVkResult({ endResult, semaphoreResult, transferResult }, "failed to submit upload batch");
+
+			// matching acquires on the graphics queue once the copies have finished, writes to concurrent
+			// destinations are made visible to dstStage by the semaphore wait alone
+			batch.acquireCmd = beginCommands(mGraphicsCmdPool);
+			for (VkBufferMemoryBarrier& acquire : barriers) {
+				acquire.srcAccessMask = 0; // ignored by the acquiring queue
+			}
+			if (!barriers.empty()) {
+				vkCmdPipelineBarrier(
+					batch.acquireCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage,
+					0, 0, nullptr, (uint)barriers.size(), barriers.data(), 0, nullptr
+				);
+			}
+			VkResult acquireEndResult = vkEndCommandBuffer(batch.acquireCmd);
+
+			VkSubmitInfo acquireSubmit{};
+			acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireSubmit.waitSemaphoreCount = 1;
+			acquireSubmit.pWaitSemaphores = &batch.semaphore;
+			acquireSubmit.pWaitDstStageMask = &dstStage;
+			acquireSubmit.commandBufferCount = 1;
+			acquireSubmit.pCommandBuffers = &batch.acquireCmd;
+
+			VkResult acquireResult = vkQueueSubmit(mDevice.graphicsQueue(), 1, &acquireSubmit, batch.state->fence);
+			checkVkResult({ acquireEndResult, acquireResult }, "failed to submit upload ownership acquire");
+		}
+
+		batch.state->submitted = true;
+		mStats.submissions++;
+	}
+
+	void Uploader::retire(Batch& batch) {
+		batch.state->done = true;
+		vkDestroyFence(mDevice.vkDevice(), batch.state->fence, nullptr);
+		batch.state->fence = VK_NULL_HANDLE;
+
+		if (batch.semaphore != VK_NULL_HANDLE) {
+			vkDestroySemaphore(mDevice.vkDevice(), batch.semaphore, nullptr);
+			vkFreeCommandBuffers(mDevice.vkDevice(), mTransferCmdPool, 1, &batch.transferCmd);
+			vkFreeCommandBuffers(mDevice.vkDevice(), mGraphicsCmdPool, 1, &batch.acquireCmd);
+		}
+		else {
+			vkFreeCommandBuffers(mDevice.vkDevice(), mGraphicsCmdPool, 1, &batch.transferCmd);
+		}
+
+		for (Buffer& staging : batch.oversized) {
+			ResourceManager::destroyBuffer(mDevice, staging.buffer, staging.memory);
+		}
+
+		if (batch.usesRing) {
+			mRingTail = batch.ringEnd;
+			mRingFull = false;
+		}
+	}
+
+	VkCommandBuffer Uploader::beginCommands(VkCommandPool pool) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = pool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		VkResult allocResult = vkAllocateCommandBuffers(mDevice.vkDevice(), &allocInfo, &commandBuffer);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		VkResult beginResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		checkVkResult({ allocResult, beginResult }, "failed to begin upload command buffer");
+		return commandBuffer;
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "ResourceManager.h"
+
+namespace cp {
+	class Uploader;
+
+	// completion of an asynchronous upload, default constructed futures are complete
+	class UploadFuture {
+	public:
+		bool ready() const;
+		// flushes the batch holding the upload if it wasn't submitted yet
+		void wait() const;
+
+	private:
+		struct State {
+			Uploader* uploader = nullptr;
+			VkDevice device = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			bool submitted = false;
+			// set once the fence was seen signaled, the fence is destroyed afterwards
+			std::atomic<bool> done = false;
+		};
+
+		std::shared_ptr<State> mState;
+
+		friend class Uploader;
+	};
+
+	struct UploadStatistics {
+		uint64 copies = 0;
+		uint64 submissions = 0;
+		uint64 bytesStaged = 0;
+		// written straight into host visible destination memory
+		uint64 bytesDirect = 0;
+	};
+
+	// Batches buffer uploads through a persistently mapped staging ring. Copies accumulate until flush(),
+	// which records all of them into one command buffer and submits it with a single fence. With a dedicated
+	// transfer queue the batch runs there and ownership of the copied range of every exclusive destination is
+	// released to the graphics family and acquired by a barrier on the graphics queue, concurrent destinations
+	// only need a memory barrier. Otherwise the copies and one barrier go to the graphics queue directly.
+	// Graphics work submitted after the flush is ordered after the barriers.
+	// Not thread safe, has to be used from the thread submitting to the graphics queue.
+	class Uploader {
+	public:
+		static constexpr VkDeviceSize defaultRingSize = 32ull << 20;
+
+		Uploader(Device& device, VkDeviceSize ringSize = defaultRingSize);
+		~Uploader();
+
+		// host visible destinations are written directly and complete immediately,
+		// the destination range must not be read by work still in flight. Exclusive destinations are
+		// handed to the graphics family by the upload, only concurrent ones can be uploaded into again
+		UploadFuture upload(
+			VkBuffer dst,
+			const MemoryAllocation& dstMemory,
+			const void* data,
+			size_t size,
+			VkAccessFlags dstAccess,
+			VkPipelineStageFlags dstStage,
+			VkDeviceSize dstOffset = 0,
+			BufferSharing dstSharing = BufferSharing::Exclusive
+		);
+
+		void flush();
+		// releases the ring space and command buffers of finished batches
+		void collect();
+		void wait();
+
+		const UploadStatistics& statistics() const { return mStats; }
+
+	private:
+		struct Copy {
+			VkBuffer src = VK_NULL_HANDLE;
+			VkBuffer dst = VK_NULL_HANDLE;
+			VkBufferCopy region{};
+			VkAccessFlags dstAccess = 0;
+			VkPipelineStageFlags dstStage = 0;
+			BufferSharing dstSharing = BufferSharing::Exclusive;
+		};
+
+		struct Batch {
+			std::vector<Copy> copies;
+			// staging buffers of uploads too large for the ring
+			std::vector<Buffer> oversized;
+			VkDeviceSize ringEnd = 0;
+			bool usesRing = false;
+
+			VkCommandBuffer transferCmd = VK_NULL_HANDLE;
+			VkCommandBuffer acquireCmd = VK_NULL_HANDLE;
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			std::shared_ptr<UploadFuture::State> state;
+		};
+
+		void beginBatch();
+		bool allocateRing(VkDeviceSize size, VkDeviceSize& offset);
+		void retire(Batch& batch);
+		void submit(Batch& batch);
+		VkCommandBuffer beginCommands(VkCommandPool pool);
+
+	private:
+		Device& mDevice;
+		VkCommandPool mGraphicsCmdPool = VK_NULL_HANDLE;
+		VkCommandPool mTransferCmdPool = VK_NULL_HANDLE;
+
+		Buffer mRing{};
+		VkDeviceSize mRingSize = 0;
+		VkDeviceSize mRingHead = 0;
+		// start of the oldest range still read by a batch, equal to mRingHead when nothing is live
+		VkDeviceSize mRingTail = 0;
+		bool mRingFull = false;
+
+		Batch mBatch;
+		std::deque<Batch> mInFlight;
+		UploadStatistics mStats{};
+	};
+}
@@ -4,7 +4,9 @@ namespace cp {
 	VulkanContext::VulkanContext(const ApplicationConfiguration& appConfig)
 		: mAppConfig(appConfig) {
 
-		glfwInit();
+		if (!mAppConfig.headless) {
+			glfwInit();
+		}
 		createInstance();
 		createDebugMessenger();
 	}
@@ -20,8 +22,10 @@ namespace cp {
 		vkDestroyInstance(mInstance, nullptr);
 		CP_DEBUG_LOG("instance destroyed");
 
-		glfwTerminate();
-		CP_DEBUG_LOG("glfw terminated");
+		if (!mAppConfig.headless) {
+			glfwTerminate();
+			CP_DEBUG_LOG("glfw terminated");
+		}
 	}
 
 	void VulkanContext::createInstance() {
@@ -38,7 +42,7 @@ namespace cp {
 		appInfo.pEngineName = "Capy Engine";
 
 		uint reqExtensionCount = 0;
-		const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&reqExtensionCount);
+		const char** requiredExtensions = mAppConfig.headless ? nullptr : glfwGetRequiredInstanceExtensions(&reqExtensionCount);
 		std::vector<const char*> extensions;
 		extensions.reserve(reqExtensionCount + mEnabledExtensions.size());
 		extensions.insert(extensions.end(), requiredExtensions, requiredExtensions + reqExtensionCount);
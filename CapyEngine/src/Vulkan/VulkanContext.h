@@ -6,6 +6,8 @@ namespace cp {
 	struct ApplicationConfiguration {
 		std::string_view applicationName = "Capy Engine Application";
 		uint applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		// no GLFW and no surface extensions, for offscreen rendering on machines without a display
+		bool headless = false;
 	};
 
 	class VulkanContext {
@@ -13,11 +13,20 @@
 #include <algorithm>
 #include <optional>
 #include <unordered_set>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <functional>
 #include <memory>
 #include <filesystem>
+#include <bit>
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <set>
+#include <map>
+#include <deque>
+#include <mutex>
 
 #ifdef _MSC_VER
 	#define NOMINMAX
@@ -34,8 +43,9 @@
 		std::cerr << "Assertion failed in function " << __FUNCTION__ << " in file " << __FILE__ << ", details:\n" << err << "\n"; \
 		std::abort(); \
 	}
-	#define CP_DEBUG_VULKAN(severity, message) printf("%s %s\n", severity, message)
-	#define CP_DEBUG_LOG(fmt, ...) printf("\033[36m[Info]\033[0m " fmt "\n" CP_VA_ARGS(__VA_ARGS__))
+	// all logging goes to stderr, stdout belongs to the application (CapyBench writes its JSON report there)
+	#define CP_DEBUG_VULKAN(severity, message) fprintf(stderr, "%s %s\n", severity, message)
+	#define CP_DEBUG_LOG(fmt, ...) fprintf(stderr, "\033[36m[Info]\033[0m " fmt "\n" CP_VA_ARGS(__VA_ARGS__))
 	#define CP_DEBUG_ERROR(fmt, ...) fprintf(stderr, "\033[31m[Error]\033[0m " fmt "\n" CP_VA_ARGS(__VA_ARGS__))
 #else 
 	#define CP_ASSERT()
@@ -56,6 +66,8 @@ namespace cp {
 	struct QueueFamilyIndices {
 		std::optional<uint> graphicsFamily;
 		std::optional<uint> presentFamily;
+		// family with transfer support but without graphics, empty when the device has none
+		std::optional<uint> transferFamily;
 		bool complete() const { return graphicsFamily.has_value() && presentFamily.has_value(); }
 	};
 